@@ -0,0 +1,197 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ActivityHeatmap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "CoarseMotion.h"
+
+namespace
+{
+
+const char* FILE_TAG = "halloweeneyes-heatmap";
+
+}
+
+
+ActivityHeatmap::ActivityHeatmap(const cv::Size& detectionSize_)
+  : detectionSize(detectionSize_),
+  tilesX((detectionSize_.width + CoarseMotion::TILE_SIZE - 1) / CoarseMotion::TILE_SIZE),
+  tilesY((detectionSize_.height + CoarseMotion::TILE_SIZE - 1) / CoarseMotion::TILE_SIZE),
+  decay(std::pow(0.5, 1.0 / HALF_LIFE_FRAMES)),
+  trackActivity(tilesX * tilesY, 0.0),
+  noiseActivity(tilesX * tilesY, 0.0)
+{ }
+
+
+bool ActivityHeatmap::load(const std::string& fileName)
+{
+  FILE* file = fopen(fileName.c_str(), "r");
+  if (!file)
+  {
+    return false;
+  }
+
+  char tag[32] = "";
+  int x = 0;
+  int y = 0;
+  bool ok = fscanf(file, "%31s %d %d", tag, &x, &y) == 3 && std::string(tag) == FILE_TAG &&
+            x == tilesX && y == tilesY;
+  std::vector<double> tracks(trackActivity.size());
+  std::vector<double> noise(noiseActivity.size());
+  for (size_t i = 0; ok && i < tracks.size(); ++i)
+  {
+    ok = fscanf(file, "%lf", &tracks[i]) == 1;
+  }
+  for (size_t i = 0; ok && i < noise.size(); ++i)
+  {
+    ok = fscanf(file, "%lf", &noise[i]) == 1;
+  }
+  fclose(file);
+
+  if (ok)
+  {
+    trackActivity.swap(tracks);
+    noiseActivity.swap(noise);
+  }
+  return ok;
+}
+
+
+bool ActivityHeatmap::save(const std::string& fileName) const
+{
+  // written next to the old one first, a crash never leaves half a map
+  const std::string temporary = fileName + ".tmp";
+  FILE* file = fopen(temporary.c_str(), "w");
+  if (!file)
+  {
+    return false;
+  }
+
+  // the track activity of all tiles, then their noise activity
+  fprintf(file, "%s %d %d\n", FILE_TAG, tilesX, tilesY);
+  for (int ty = 0; ty < tilesY; ++ty)
+  {
+    for (int tx = 0; tx < tilesX; ++tx)
+    {
+      fprintf(file, "%10.1lf ", trackActivity[ty * tilesX + tx]);
+    }
+    fprintf(file, "\n");
+  }
+  fprintf(file, "\n");
+  for (int ty = 0; ty < tilesY; ++ty)
+  {
+    for (int tx = 0; tx < tilesX; ++tx)
+    {
+      fprintf(file, "%10.1lf ", noiseActivity[ty * tilesX + tx]);
+    }
+    fprintf(file, "\n");
+  }
+
+  const bool written = fclose(file) == 0;
+  return written && rename(temporary.c_str(), fileName.c_str()) == 0;
+}
+
+
+int ActivityHeatmap::tileIndex(double x, double y) const
+{
+  const int tx = std::max(0, std::min(tilesX - 1, int(x) / CoarseMotion::TILE_SIZE));
+  const int ty = std::max(0, std::min(tilesY - 1, int(y) / CoarseMotion::TILE_SIZE));
+  return ty * tilesX + tx;
+}
+
+
+void ActivityHeatmap::add(const std::vector<Track>& tracks, const std::vector<Blob>& blobs)
+{
+  for (size_t i = 0; i < trackActivity.size(); ++i)
+  {
+    trackActivity[i] *= decay;
+    noiseActivity[i] *= decay;
+  }
+
+  for (size_t i = 0; i < tracks.size(); ++i)
+  {
+    if (tracks[i].confirmed && tracks[i].updated)
+    {
+      trackActivity[tileIndex(tracks[i].x, tracks[i].y)] += 1;
+    }
+  }
+
+  for (size_t b = 0; b < blobs.size(); ++b)
+  {
+    const cv::Point centre(cvRound(blobs[b].centroidX), cvRound(blobs[b].centroidY));
+    bool tracked = false;
+    for (size_t i = 0; i < tracks.size() && !tracked; ++i)
+    {
+      tracked = tracks[i].updated && tracks[i].boundingRect.contains(centre);
+    }
+    if (!tracked)
+    {
+      noiseActivity[tileIndex(blobs[b].centroidX, blobs[b].centroidY)] += 1;
+    }
+  }
+}
+
+
+void ActivityHeatmap::hotTiles(std::vector<uint8_t>& tiles) const
+{
+  tiles.assign(trackActivity.size(), 1);
+
+  double total = 0;
+  double hottest = 0;
+  for (size_t i = 0; i < trackActivity.size(); ++i)
+  {
+    total += trackActivity[i];
+    hottest = std::max(hottest, trackActivity[i]);
+  }
+  if (total < MIN_TRACK_ACTIVITY)
+  {
+    return;
+  }
+
+  // a tile stays hot if it or a neighbour saw a noticeable share of the tracks,
+  // people walk in from the neighbouring tiles, but not if it only ever had noise
+  const double minimum = hottest / 100;
+  for (int ty = 0; ty < tilesY; ++ty)
+  {
+    for (int tx = 0; tx < tilesX; ++tx)
+    {
+      const int index = ty * tilesX + tx;
+      bool hot = trackActivity[index] >= minimum;
+      if (hot || noiseActivity[index] >= minimum)
+      {
+        tiles[index] = hot;
+        continue;
+      }
+      for (int ny = std::max(0, ty - 1); ny <= std::min(tilesY - 1, ty + 1) && !hot; ++ny)
+      {
+        for (int nx = std::max(0, tx - 1); nx <= std::min(tilesX - 1, tx + 1) && !hot; ++nx)
+        {
+          hot = trackActivity[ny * tilesX + nx] >= minimum;
+        }
+      }
+      tiles[index] = hot;
+    }
+  }
+}
@@ -0,0 +1,94 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ACTIVITY_HEATMAP_H_INCLUDED
+#define ACTIVITY_HEATMAP_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ConnectedComponents.h"
+#include "MotionTracker.h"
+
+/**
+   Remembers per tile of CoarseMotion where real objects walk and where
+   only noise fires, to find the region of interest without drawing one.
+
+   Every frame, the tile of each confirmed track that was seen adds one to
+   the tile's track activity, every blob that no such track covers adds one
+   to its noise activity. Both decay with a half-life of HALF_LIFE_FRAMES,
+   a few hours of detection, so the map follows a changed scene.
+
+   Once the map has seen enough tracks, tiles with less than a hundredth of
+   the busiest tile's track activity are cold, unless a neighbour is above
+   that and the tile itself is not known for noise alone. The detection
+   computes cold tiles only in bursts of COLD_BURST frames every
+   COLD_PERIOD frames, and the MotionTracker searches the whole image in
+   every frame of a burst. A burst is long enough for the tracker to
+   confirm a new object, and the gap short enough for a confirmed track to
+   survive it, so an object in a cold tile is still followed and heats the
+   tile up.
+
+   The map is kept in a small text file between runs.
+ */
+class ActivityHeatmap
+{
+public:
+
+  //frames until an activity has decayed to half, about four hours at 25 fps
+  static const uint32_t HALF_LIFE_FRAMES = 360000;
+  //track activity needed before any tile is taken for cold
+  static const uint32_t MIN_TRACK_ACTIVITY = 2000;
+  //cold tiles are computed in the first COLD_BURST frames of every COLD_PERIOD,
+  //COLD_PERIOD - COLD_BURST must not exceed MotionTracker::MAX_MISSES
+  static const uint32_t COLD_PERIOD = 15;
+  static const uint32_t COLD_BURST = MotionTracker::CONFIRM_HITS;
+
+  explicit ActivityHeatmap(const cv::Size& detectionSize);
+
+  /** False if the file does not exist or was written for another tile grid. */
+  bool load(const std::string& fileName);
+  bool save(const std::string& fileName) const;
+
+  /** Adds the tracks and blobs of a frame. */
+  void add(const std::vector<Track>& tracks, const std::vector<Blob>& blobs);
+
+  /** Per tile, row by row: 1 for tiles that need to be computed in every frame, 0 for cold ones. */
+  void hotTiles(std::vector<uint8_t>& tiles) const;
+
+private:
+
+  int tileIndex(double x, double y) const;
+
+  const cv::Size detectionSize;
+  const int tilesX;
+  const int tilesY;
+  //factor applied to all activities per frame
+  const double decay;
+
+  std::vector<double> trackActivity;
+  std::vector<double> noiseActivity;
+};
+
+
+#endif
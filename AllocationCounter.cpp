@@ -0,0 +1,122 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "AllocationCounter.h"
+
+#ifdef COUNT_ALLOCATIONS
+
+#include <cerrno>
+#include <cstddef>
+
+namespace
+{
+
+// static TLS of the executable, reading it never allocates
+__thread uint64_t allocations = 0;
+
+}
+
+extern "C"
+{
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* pointer);
+
+
+void* malloc(size_t size)
+{
+  ++allocations;
+  return __libc_malloc(size);
+}
+
+
+void* calloc(size_t count, size_t size)
+{
+  ++allocations;
+  return __libc_calloc(count, size);
+}
+
+
+void* realloc(void* pointer, size_t size)
+{
+  ++allocations;
+  return __libc_realloc(pointer, size);
+}
+
+
+void* memalign(size_t alignment, size_t size)
+{
+  ++allocations;
+  return __libc_memalign(alignment, size);
+}
+
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+  ++allocations;
+  return __libc_memalign(alignment, size);
+}
+
+
+int posix_memalign(void** pointer, size_t alignment, size_t size)
+{
+  ++allocations;
+  *pointer = __libc_memalign(alignment, size);
+  return *pointer ? 0 : ENOMEM;
+}
+
+
+void free(void* pointer)
+{
+  __libc_free(pointer);
+}
+
+}
+
+
+bool AllocationCounter::enabled()
+{
+  return true;
+}
+
+
+uint64_t AllocationCounter::threadAllocations()
+{
+  return allocations;
+}
+
+#else
+
+bool AllocationCounter::enabled()
+{
+  return false;
+}
+
+
+uint64_t AllocationCounter::threadAllocations()
+{
+  return 0;
+}
+
+#endif
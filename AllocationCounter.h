@@ -0,0 +1,47 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ALLOCATION_COUNTER_H_INCLUDED
+#define ALLOCATION_COUNTER_H_INCLUDED
+
+#include <cstdint>
+
+/**
+   Counts heap allocations per thread, to check that the detection stages
+   do not allocate once they are warmed up.
+
+   Only active if built with -DCOUNT_ALLOCATIONS=ON. malloc and friends are
+   then replaced by versions that count and forward to glibc, which catches
+   cv::Mat buffers as well as operator new. Without it the count stays 0.
+ */
+namespace AllocationCounter
+{
+
+/** True if the counting allocator is compiled in. */
+bool enabled();
+
+/** Heap allocations the calling thread has made so far. */
+uint64_t threadAllocations();
+
+}
+
+
+#endif
@@ -0,0 +1,110 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "BackgroundModel.h"
+
+#include <algorithm>
+
+namespace
+{
+
+const int RATE_BITS = 12;
+
+}
+
+
+/** Learns a band of rows. */
+class BackgroundModelJob : public BandJob
+{
+public:
+
+  BackgroundModelJob(BackgroundModel& model_, const cv::Mat& current_, cv::Mat& background_, unsigned int bands_)
+    : model(model_), current(current_), background(background_), bands(bands_)
+  { }
+
+
+  virtual void operator()(unsigned int band, unsigned int) const
+  {
+    model.learn(current, background, current.rows * band / bands, current.rows * (band + 1) / bands);
+  }
+
+private:
+
+  BackgroundModel& model;
+  const cv::Mat& current;
+  cv::Mat& background;
+  const unsigned int bands;
+};
+
+
+BackgroundModel::BackgroundModel(double learningRate, BandPool* pool_)
+  : rate(std::max(1, std::min(1 << RATE_BITS, cvRound(learningRate * (1 << RATE_BITS))))),
+  pool(pool_),
+  hasModel(false)
+{ }
+
+
+void BackgroundModel::reset()
+{
+  hasModel = false;
+}
+
+
+bool BackgroundModel::apply(const cv::Mat& current, cv::Mat& background)
+{
+  if (!hasModel || model.rows != current.rows || model.cols != current.cols)
+  {
+    current.convertTo(model, CV_16U, 256);
+    hasModel = true;
+    return false;
+  }
+
+  background.create(current.rows, current.cols, CV_8UC1);
+  if (pool)
+  {
+    const unsigned int bands = std::min<unsigned int>(pool->threads(), current.rows);
+    pool->run(bands, BackgroundModelJob(*this, current, background, bands));
+  }
+  else
+  {
+    learn(current, background, 0, current.rows);
+  }
+  return true;
+}
+
+
+void BackgroundModel::learn(const cv::Mat& current, cv::Mat& background, int begin, int end)
+{
+  const int32_t round = 1 << (RATE_BITS - 1);
+  for (int y = begin; y < end; ++y)
+  {
+    const uint8_t* in = current.ptr<uint8_t>(y);
+    uint16_t* learned = model.ptr<uint16_t>(y);
+    uint8_t* out = background.ptr<uint8_t>(y);
+    for (int x = 0; x < current.cols; ++x)
+    {
+      // the difference times the rate fits into 32 bit, the result stays within 0 ... 255 * 256
+      const int32_t value = learned[x];
+      out[x] = uint8_t(value >> 8);
+      learned[x] = uint16_t(value + ((((int32_t(in[x]) << 8) - value) * rate + round) >> RATE_BITS));
+    }
+  }
+}
@@ -0,0 +1,82 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef BACKGROUND_MODEL_H_INCLUDED
+#define BACKGROUND_MODEL_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <cstdint>
+
+#include "BandPool.h"
+
+/**
+   Running average of the gray frames, the alternative to comparing each
+   frame with the previous one. Someone walking slowly stays visible for as
+   long as they differ from the background, and a fast walker appears only
+   once instead of at the old and the new position.
+
+   The model is kept per pixel in 8.8 fixed point and learns
+
+   model += learningRate * (current - model)
+
+   with the rate in 1/4096 steps. The update is a plain integer loop the
+   compiler vectorises, one pass that also writes the 8 bit background the
+   motion mask is computed against. With a BandPool the rows are split into
+   one band per thread.
+
+   An instance must only be used by one thread at a time.
+ */
+class BackgroundModel
+{
+public:
+
+  /**
+     learningRate is the weight of a new frame, between 1/4096 and 1. pool
+     may be NULL to run on the calling thread only.
+   */
+  explicit BackgroundModel(double learningRate, BandPool* pool = NULL);
+
+  /** Forgets the model, the next frame starts a new one. */
+  void reset();
+
+  /**
+     Writes the background as it was before current into background and
+     learns current. The first frame after a reset only initialises the
+     model and returns false.
+   */
+  bool apply(const cv::Mat& current, cv::Mat& background);
+
+private:
+
+  friend class BackgroundModelJob;
+
+  void learn(const cv::Mat& current, cv::Mat& background, int begin, int end);
+
+  //weight of a new frame in 1/4096
+  const int32_t rate;
+  BandPool* const pool;
+  //CV_16UC1, gray value * 256
+  cv::Mat model;
+  bool hasModel;
+};
+
+
+#endif
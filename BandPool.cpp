@@ -0,0 +1,132 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "BandPool.h"
+
+#include <algorithm>
+
+BandPool::BandPool(unsigned int threads)
+  : threadCount(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+  generation(0),
+  busyWorkers(0),
+  stopping(false),
+  job(NULL),
+  bandCount(0),
+  nextBand(0)
+{
+  for (unsigned int i = 1; i < threadCount; ++i)
+  {
+    workers.push_back(std::thread(&BandPool::worker, this, i));
+  }
+}
+
+
+BandPool::~BandPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobAvailable.notify_all();
+
+  for (size_t i = 0; i < workers.size(); ++i)
+  {
+    workers[i].join();
+  }
+}
+
+
+void BandPool::run(unsigned int bands, const BandJob& job_)
+{
+  std::lock_guard<std::mutex> runLock(runMutex);
+
+  // not worth waking anybody
+  if (workers.empty() || bands <= 1)
+  {
+    for (unsigned int band = 0; band < bands; ++band)
+    {
+      job_(band, 0);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job = &job_;
+    bandCount = bands;
+    nextBand = 0;
+    busyWorkers = workers.size();
+    generation += 1;
+  }
+  jobAvailable.notify_all();
+
+  work(0);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (busyWorkers > 0)
+  {
+    jobDone.wait(lock);
+  }
+  job = NULL;
+}
+
+
+void BandPool::worker(unsigned int thread)
+{
+  uint64_t done = 0;
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (generation == done && !stopping)
+      {
+        jobAvailable.wait(lock);
+      }
+      if (stopping)
+      {
+        return;
+      }
+      done = generation;
+    }
+
+    work(thread);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      busyWorkers -= 1;
+    }
+    jobDone.notify_one();
+  }
+}
+
+
+void BandPool::work(unsigned int thread)
+{
+  for (;;)
+  {
+    const unsigned int band = nextBand.fetch_add(1);
+    if (band >= bandCount)
+    {
+      return;
+    }
+    (*job)(band, thread);
+  }
+}
@@ -0,0 +1,102 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef BAND_POOL_H_INCLUDED
+#define BAND_POOL_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Work split into bands for BandPool::run(). */
+class BandJob
+{
+public:
+
+  virtual ~BandJob()
+  { }
+
+
+  /** Processes one band, thread is the index of the calling thread within the pool. */
+  virtual void operator()(unsigned int band, unsigned int thread) const = 0;
+};
+
+
+/**
+   Persistent worker threads for the per pixel work of the detection, split
+   into row bands.
+
+   run() hands out the bands of a job to the workers and the calling thread,
+   one at a time, and returns when all are done. Jobs keep one workspace per
+   thread index, so no two bands running at the same time share one. The
+   threads are started once and sleep between jobs, nothing is allocated
+   per job.
+
+   Several pipeline stages may share a pool, their jobs run one after the
+   other.
+ */
+class BandPool
+{
+public:
+
+  /** threads counts the calling thread, 0 means one per core. */
+  explicit BandPool(unsigned int threads);
+  virtual ~BandPool();
+
+  /** Number of threads a job runs on, the calling one included. */
+  unsigned int threads() const
+  {
+    return threadCount;
+  }
+
+  void run(unsigned int bands, const BandJob& job);
+
+private:
+
+  BandPool(const BandPool&);
+  BandPool& operator=(const BandPool&);
+
+  void worker(unsigned int thread);
+  void work(unsigned int thread);
+
+  unsigned int threadCount;
+  std::vector<std::thread> workers;
+
+  //one job at a time
+  std::mutex runMutex;
+
+  std::mutex mutex;
+  std::condition_variable jobAvailable;
+  std::condition_variable jobDone;
+  uint64_t generation;
+  unsigned int busyWorkers;
+  bool stopping;
+
+  const BandJob* job;
+  unsigned int bandCount;
+  std::atomic<unsigned int> nextBand;
+};
+
+
+#endif
@@ -0,0 +1,168 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef BOUNDED_QUEUE_H_INCLUDED
+#define BOUNDED_QUEUE_H_INCLUDED
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+   Blocking multi-producer/multi-consumer FIFO with a fixed capacity, used to
+   hand work between pipeline threads. push() blocks while the queue is full,
+   which is what propagates back pressure to the earlier stages. Storage is
+   allocated once in the constructor.
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+
+  explicit BoundedQueue(size_t capacity)
+    : items(capacity), head(0), count(0), closed(false)
+  { }
+
+
+  /** Blocks while the queue is full. Returns false if the queue was closed. */
+  bool push(const T& value)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (count == items.size() && !closed)
+    {
+      notFull.wait(lock);
+    }
+    if (closed)
+    {
+      return false;
+    }
+    enqueue(value);
+    lock.unlock();
+    notEmpty.notify_one();
+    return true;
+  }
+
+
+  /** Returns false instead of blocking if the queue is full or closed. */
+  bool tryPush(const T& value)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (count == items.size() || closed)
+    {
+      return false;
+    }
+    enqueue(value);
+    lock.unlock();
+    notEmpty.notify_one();
+    return true;
+  }
+
+
+  /** Blocks while the queue is empty. Returns false once it is closed and drained. */
+  bool pop(T& value)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (count == 0 && !closed)
+    {
+      notEmpty.wait(lock);
+    }
+    if (count == 0)
+    {
+      return false;
+    }
+    dequeue(value);
+    lock.unlock();
+    notFull.notify_one();
+    return true;
+  }
+
+
+  bool tryPop(T& value)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (count == 0)
+    {
+      return false;
+    }
+    dequeue(value);
+    lock.unlock();
+    notFull.notify_one();
+    return true;
+  }
+
+
+  /** Wakes up all waiting threads, pushes fail from now on, pops drain what is left. */
+  void close()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      closed = true;
+    }
+    notEmpty.notify_all();
+    notFull.notify_all();
+  }
+
+
+  size_t size() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+  }
+
+
+  size_t capacity() const
+  {
+    return items.size();
+  }
+
+
+private:
+
+  BoundedQueue(const BoundedQueue&);
+  BoundedQueue& operator=(const BoundedQueue&);
+
+  void enqueue(const T& value)
+  {
+    items[(head + count) % items.size()] = value;
+    ++count;
+  }
+
+
+  void dequeue(T& value)
+  {
+    value = items[head];
+    head = (head + 1) % items.size();
+    --count;
+  }
+
+
+  mutable std::mutex mutex;
+  std::condition_variable notEmpty;
+  std::condition_variable notFull;
+  std::vector<T> items;
+  size_t head;
+  size_t count;
+  bool closed;
+};
+
+
+#endif
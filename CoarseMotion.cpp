@@ -0,0 +1,143 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "CoarseMotion.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+CoarseMotion::CoarseMotion(const cv::Size& detectionSize_, int reach_)
+  : detectionSize(detectionSize_),
+  reach(reach_),
+  tilesX((detectionSize_.width + TILE_SIZE - 1) / TILE_SIZE),
+  tilesY((detectionSize_.height + TILE_SIZE - 1) / TILE_SIZE),
+  tiles(tilesX * tilesY),
+  changedPixels(0),
+  comparedPixels(0),
+  brightnessChange(0)
+{
+  activeRegions.reserve(tiles.size());
+}
+
+
+cv::Size CoarseMotion::coarseSize(const cv::Size& detectionSize)
+{
+  return cv::Size(std::max(1, detectionSize.width / FACTOR), std::max(1, detectionSize.height / FACTOR));
+}
+
+
+bool CoarseMotion::compare(const cv::Mat& lastCoarse, const cv::Mat& currentCoarse,
+                           const std::vector<uint8_t>* tileFilter)
+{
+  std::fill(tiles.begin(), tiles.end(), 0);
+  activeRegions.clear();
+  changedPixels = 0;
+  comparedPixels = currentCoarse.rows * currentCoarse.cols;
+  brightnessChange = 0;
+
+  for (int cy = 0; cy < currentCoarse.rows; ++cy)
+  {
+    const uint8_t* last = lastCoarse.ptr<uint8_t>(cy);
+    const uint8_t* current = currentCoarse.ptr<uint8_t>(cy);
+    for (int cx = 0; cx < currentCoarse.cols; ++cx)
+    {
+      const int difference = int(current[cx]) - int(last[cx]);
+      brightnessChange += difference;
+      if (std::abs(difference) <= THRESHOLD)
+      {
+        continue;
+      }
+      changedPixels += 1;
+
+      // the tiles whose mask pixels may see this change through the box filter
+      const int x0 = std::max(0, cx * FACTOR - reach) / TILE_SIZE;
+      const int x1 = std::min(detectionSize.width - 1, (cx + 1) * FACTOR - 1 + reach) / TILE_SIZE;
+      const int y0 = std::max(0, cy * FACTOR - reach) / TILE_SIZE;
+      const int y1 = std::min(detectionSize.height - 1, (cy + 1) * FACTOR - 1 + reach) / TILE_SIZE;
+      for (int ty = y0; ty <= y1; ++ty)
+      {
+        for (int tx = x0; tx <= x1; ++tx)
+        {
+          tiles[ty * tilesX + tx] = 1;
+        }
+      }
+    }
+  }
+
+  if (tileFilter)
+  {
+    for (size_t i = 0; i < tiles.size(); ++i)
+    {
+      tiles[i] = tiles[i] && (*tileFilter)[i];
+    }
+  }
+
+  collectRegions();
+  return !activeRegions.empty();
+}
+
+
+bool CoarseMotion::illuminationChanged() const
+{
+  return comparedPixels > 0 &&
+         (changedPixels * 100 >= comparedPixels * ILLUMINATION_CHANGED_PERCENT ||
+          std::abs(brightnessChange) >= int64_t(comparedPixels) * ILLUMINATION_MEAN_CHANGE);
+}
+
+
+void CoarseMotion::select(const std::vector<uint8_t>& tileFilter)
+{
+  for (size_t i = 0; i < tiles.size(); ++i)
+  {
+    tiles[i] = tileFilter[i] != 0;
+  }
+  activeRegions.clear();
+  collectRegions();
+}
+
+
+void CoarseMotion::collectRegions()
+{
+  // runs of flagged tiles in a row become one region
+  for (int ty = 0; ty < tilesY; ++ty)
+  {
+    int tx = 0;
+    while (tx < tilesX)
+    {
+      if (!tiles[ty * tilesX + tx])
+      {
+        ++tx;
+        continue;
+      }
+
+      const int begin = tx;
+      while (tx < tilesX && tiles[ty * tilesX + tx])
+      {
+        ++tx;
+      }
+
+      const int x = begin * TILE_SIZE;
+      const int y = ty * TILE_SIZE;
+      activeRegions.push_back(cv::Rect(x, y, std::min(tx * TILE_SIZE, detectionSize.width) - x,
+                                       std::min(y + TILE_SIZE, detectionSize.height) - y));
+    }
+  }
+}
@@ -0,0 +1,114 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef COARSE_MOTION_H_INCLUDED
+#define COARSE_MOTION_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <cstdint>
+#include <vector>
+
+/**
+   Decides on heavily downsampled frames where anything changed at all, so
+   the full resolution motion mask is only computed there.
+
+   The coarse frames are the detection frames reduced by FACTOR in both
+   directions, 80x60 for 320x240. A coarse pixel whose difference exceeds
+   THRESHOLD flags every tile of the detection image that the box filter
+   around it reaches. Flagged tiles next to each other in a row are merged
+   into one rectangle.
+
+   The same pass measures how much of the picture changed and by how much
+   its mean brightness moved. If most of it changed, or all of it got
+   brighter or darker, the light changed rather than anything moving: the
+   camera switched to or from infrared, or headlights swept the yard.
+
+   Averaging FACTOR x FACTOR pixels lowers the noise, but also dilutes small
+   changes: motion covering less than about a quarter of a coarse pixel's
+   area, or of low contrast, is not noticed, and changes in opposite
+   directions within a coarse pixel cancel out. The full resolution mask
+   may still find those, so the check is only used with
+   MotionSettings::coarseCheck.
+
+   An instance must only be used by one thread at a time, it does not
+   allocate after the first frame.
+ */
+class CoarseMotion
+{
+public:
+
+  //downsampling of the coarse frames
+  static const int FACTOR = 4;
+  //difference of a coarse pixel that counts as change
+  static const int THRESHOLD = 10;
+  //side length of a tile in pixels of the detection image
+  static const int TILE_SIZE = 40;
+  //changed share of the coarse pixels that is taken for a change of the light
+  static const int ILLUMINATION_CHANGED_PERCENT = 60;
+  //change of the mean brightness that is taken for a change of the light
+  static const int ILLUMINATION_MEAN_CHANGE = 20;
+
+  /** reach is how far the mask computation looks around a pixel, e.g. the blur size. */
+  CoarseMotion(const cv::Size& detectionSize, int reach);
+
+  /** Size of the coarse frames for a detection size. */
+  static cv::Size coarseSize(const cv::Size& detectionSize);
+
+  /**
+     Compares two coarse frames and collects the regions of the detection
+     image that need the full computation. Returns false if there are none.
+     Tiles whose entry in tileFilter is 0 are left out, see RegionOfInterest.
+   */
+  bool compare(const cv::Mat& lastCoarse, const cv::Mat& currentCoarse,
+               const std::vector<uint8_t>* tileFilter = NULL);
+
+  /** True if the last compare() found a change of the light instead of motion. */
+  bool illuminationChanged() const;
+
+  /** Takes the tiles whose entry in tileFilter is not 0 as regions, without comparing anything. */
+  void select(const std::vector<uint8_t>& tileFilter);
+
+  /** The regions found by the last compare() or select(), in detection image coordinates. */
+  const std::vector<cv::Rect>& regions() const
+  {
+    return activeRegions;
+  }
+
+private:
+
+  void collectRegions();
+
+  const cv::Size detectionSize;
+  const int reach;
+  const int tilesX;
+  const int tilesY;
+
+  std::vector<uint8_t> tiles;
+  std::vector<cv::Rect> activeRegions;
+
+  //statistics of the last compare()
+  int changedPixels;
+  int comparedPixels;
+  int64_t brightnessChange;
+};
+
+
+#endif
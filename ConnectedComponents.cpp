@@ -0,0 +1,185 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ConnectedComponents.h"
+
+#include <algorithm>
+
+namespace
+{
+
+bool largerBlob(const Blob& a, const Blob& b)
+{
+  return a.area > b.area;
+}
+
+}
+
+
+uint32_t ConnectedComponents::find(uint32_t run)
+{
+  while (runs[run].parent != run)
+  {
+    // path halving keeps the trees flat
+    runs[run].parent = runs[runs[run].parent].parent;
+    run = runs[run].parent;
+  }
+  return run;
+}
+
+
+void ConnectedComponents::unite(uint32_t a, uint32_t b)
+{
+  a = find(a);
+  b = find(b);
+  // the older run stays the root, so a root is never behind its members
+  if (a < b)
+  {
+    runs[b].parent = a;
+  }
+  else if (b < a)
+  {
+    runs[a].parent = b;
+  }
+}
+
+
+bool ConnectedComponents::compute(const cv::Mat& mask, uint32_t minArea, std::vector<Blob>& blobs,
+                                  uint32_t maxRuns, size_t maxBlobs)
+{
+  blobs.clear();
+  runs.clear();
+
+  // runs of the previous row start at previousBegin
+  uint32_t previousBegin = 0;
+  uint32_t previousEnd = 0;
+  for (int y = 0; y < mask.rows; ++y)
+  {
+    const uint8_t* row = mask.ptr<uint8_t>(y);
+    const uint32_t rowBegin = runs.size();
+    uint32_t above = previousBegin;
+
+    int x = 0;
+    while (x < mask.cols)
+    {
+      if (!row[x])
+      {
+        ++x;
+        continue;
+      }
+
+      Run run;
+      run.y = y;
+      run.begin = x;
+      while (x < mask.cols && row[x])
+      {
+        ++x;
+      }
+      run.end = x;
+      run.parent = runs.size();
+      if (maxRuns > 0 && run.parent >= maxRuns)
+      {
+        runs.clear();
+        return false;
+      }
+      runs.push_back(run);
+
+      // runs of the row above touch this one if they overlap it, diagonals included
+      while (above < previousEnd && runs[above].end < run.begin)
+      {
+        ++above;
+      }
+      for (uint32_t i = above; i < previousEnd && runs[i].begin <= run.end; ++i)
+      {
+        unite(i, run.parent);
+      }
+    }
+
+    previousBegin = rowBegin;
+    previousEnd = runs.size();
+  }
+
+  // sum up every run in its root, roots come before their members
+  const uint32_t count = runs.size();
+  blobIndex.assign(count, -1);
+  sumX.resize(count);
+  sumY.resize(count);
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    const Run& run = runs[i];
+    const uint32_t root = find(i);
+    const uint32_t length = run.end - run.begin;
+
+    if (blobIndex[root] < 0)
+    {
+      blobIndex[root] = blobs.size();
+      sumX[root] = 0;
+      sumY[root] = 0;
+      Blob blob;
+      blob.boundingRect = cv::Rect(run.begin, run.y, length, 1);
+      blobs.push_back(blob);
+    }
+
+    Blob& blob = blobs[blobIndex[root]];
+    blob.area += length;
+    // sum of the x coordinates begin ... end - 1
+    sumX[root] += uint64_t(run.begin + run.end - 1) * length / 2;
+    sumY[root] += uint64_t(run.y) * length;
+
+    cv::Rect& rect = blob.boundingRect;
+    const int left = std::min(rect.x, run.begin);
+    const int right = std::max(rect.x + rect.width, run.end);
+    rect.x = left;
+    rect.width = right - left;
+    rect.height = run.y - rect.y + 1;
+  }
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    if (blobIndex[i] >= 0)
+    {
+      Blob& blob = blobs[blobIndex[i]];
+      blob.centroidX = double(sumX[i]) / blob.area;
+      blob.centroidY = double(sumY[i]) / blob.area;
+    }
+  }
+
+  // drop the small ones, then rank by area
+  size_t kept = 0;
+  for (size_t i = 0; i < blobs.size(); ++i)
+  {
+    if (blobs[i].area >= minArea)
+    {
+      blobs[kept++] = blobs[i];
+    }
+  }
+  blobs.resize(kept);
+  if (maxBlobs > 0 && kept > maxBlobs)
+  {
+    std::partial_sort(blobs.begin(), blobs.begin() + maxBlobs, blobs.end(), largerBlob);
+    blobs.resize(maxBlobs);
+  }
+  else
+  {
+    std::sort(blobs.begin(), blobs.end(), largerBlob);
+  }
+  return true;
+}
@@ -0,0 +1,96 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef CONNECTED_COMPONENTS_H_INCLUDED
+#define CONNECTED_COMPONENTS_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <cstdint>
+#include <vector>
+
+/** A connected region of set pixels in the motion mask. */
+struct Blob
+{
+  Blob()
+    : area(0), centroidX(0), centroidY(0)
+  { }
+
+
+  //number of set pixels
+  uint32_t area;
+  //centre of mass of the set pixels
+  double centroidX;
+  double centroidY;
+  cv::Rect boundingRect;
+};
+
+
+/**
+   Connected component labelling of a binary motion mask, 8-connected like
+   the contours of cv::findContours.
+
+   Every row is split into runs of set pixels, and a run is joined with the
+   runs of the row above that touch it, using union-find over the runs.
+   Area, centroid and bounding box of each component are summed up per run
+   afterwards, so a blob costs as much as its runs, not its outline.
+
+   The work grows with the runs, and a mask full of rain or snow has many
+   of them. maxRuns bounds it: labelling stops once the mask has more.
+
+   An instance owns its run buffers and must only be used by one thread at
+   a time. Once they have grown to the busiest mask seen, labelling does
+   not allocate.
+ */
+class ConnectedComponents
+{
+public:
+
+  /**
+     Finds the components of mask, an 8 bit image of 0 and 255. Components
+     smaller than minArea pixels are dropped, the others are returned in
+     blobs, largest first, at most maxBlobs of them. False without any blob
+     if the mask has more than maxRuns runs. 0 is no limit for both.
+   */
+  bool compute(const cv::Mat& mask, uint32_t minArea, std::vector<Blob>& blobs,
+               uint32_t maxRuns = 0, size_t maxBlobs = 0);
+
+private:
+
+  struct Run
+  {
+    int y;
+    int begin;
+    int end;      //one past the last pixel
+    uint32_t parent;
+  };
+
+  uint32_t find(uint32_t run);
+  void unite(uint32_t a, uint32_t b);
+
+  std::vector<Run> runs;
+  //sums of each root run's component, indexed by run
+  std::vector<uint64_t> sumX;
+  std::vector<uint64_t> sumY;
+  std::vector<int32_t> blobIndex;
+};
+
+
+#endif
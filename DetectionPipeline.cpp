@@ -0,0 +1,776 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "DetectionPipeline.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "AllocationCounter.h"
+#include "FrameSource.h"
+
+using namespace std;
+using namespace cv;
+
+DetectionPipeline::DetectionPipeline(const MotionSettings& settings_, const cv::Size& detectionSize_,
+                                     const std::shared_ptr<FrameRing>& ring)
+  : framesSkipped(0),
+  framesStale(0),
+  framesNotRecorded(0),
+  framesIdle(0),
+  framesIlluminationChange(0),
+  framesOverBudget(0),
+  framesReused(0),
+  framesCapped(0),
+  framesShed(0),
+  settings(settings_),
+  detectionSize(detectionSize_),
+  coarseSize(CoarseMotion::coarseSize(detectionSize_)),
+  frameRing(ring),
+  pool(POOL_SIZE),
+  freeQueue(POOL_SIZE),
+  differenceQueue(QUEUE_CAPACITY),
+  blobQueue(QUEUE_CAPACITY),
+  publishQueue(QUEUE_CAPACITY),
+  recordQueue(RECORD_QUEUE_CAPACITY),
+  pendingFrames(0),
+  stopping(false),
+  bandPool(settings_.detectionThreads),
+  governor(settings_.cpuBudgetPercent),
+  detector(settings_.minBlobArea, &bandPool),
+  resetRequested(false),
+  background(settings_.learningRate, &bandPool),
+  coarse(detectionSize_, MotionDetector::BLUR_SIZE),
+  roi(detectionSize_, MotionDetector::BLUR_SIZE),
+  coarseBackground(settings_.learningRate),
+  trackerResetRequested(false),
+  history(detectionSize_, &bandPool),
+  heatmap(detectionSize_),
+  frames(0),
+  framesTaken(0),
+  frameAgeFilter(100),
+  maxFrameAgeMs(0),
+  frameDump(NULL)
+{
+  for (int stage = 0; stage < STAGE_COUNT; ++stage)
+  {
+    stageAllocations[stage] = 0;
+  }
+  lastTracks.reserve(MotionTracker::MAX_TRACKS);
+  if (settings.classifyPeople)
+  {
+    classifier.reset(new PersonClassifier());
+  }
+
+  if (!settings.roiFile.empty() && !roi.load(settings.roiFile))
+  {
+    printf("cannot load region of interest %s, detecting everywhere\n", settings.roiFile.c_str());
+  }
+
+  if (!settings.heatmapFile.empty() && !heatmap.load(settings.heatmapFile))
+  {
+    printf("no activity heatmap in %s yet, starting a new one\n", settings.heatmapFile.c_str());
+  }
+  heatmap.hotTiles(hotTiles);
+
+  for (size_t i = 0; i < pool.size(); ++i)
+  {
+    freeQueue.push(&pool[i]);
+  }
+
+  if (!settings.dumpFile.empty())
+  {
+    frameDump = fopen(settings.dumpFile.c_str(), "wb");
+  }
+}
+
+
+DetectionPipeline::~DetectionPipeline()
+{
+  stop();
+}
+
+
+void DetectionPipeline::start(const PublishCallback& publish, const RecordPredicate& wantsRecording,
+                              const RecordCallback& record)
+{
+  publishCallback = publish;
+  recordPredicate = wantsRecording;
+  recordCallback = record;
+
+  threads.push_back(std::thread(&DetectionPipeline::convertStage, this));
+  threads.push_back(std::thread(&DetectionPipeline::differenceStage, this));
+  threads.push_back(std::thread(&DetectionPipeline::blobStage, this));
+  threads.push_back(std::thread(&DetectionPipeline::publishStage, this));
+  threads.push_back(std::thread(&DetectionPipeline::recordStage, this));
+}
+
+
+void DetectionPipeline::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(frameMutex);
+    //the destructor stops again after QtMotionTracking::close() did
+    if (stopping)
+    {
+      return;
+    }
+    stopping = true;
+  }
+  frameAvailable.notify_all();
+
+  freeQueue.close();
+  differenceQueue.close();
+  blobQueue.close();
+  publishQueue.close();
+  //the record stage drains its queue before it ends, nothing queued gets lost
+  recordQueue.close();
+
+  for (size_t i = 0; i < threads.size(); ++i)
+  {
+    threads[i].join();
+  }
+  threads.clear();
+
+  if (classifier)
+  {
+    classifier->close();
+  }
+
+  if (!settings.heatmapFile.empty() && !heatmap.save(settings.heatmapFile))
+  {
+    printf("cannot save activity heatmap %s\n", settings.heatmapFile.c_str());
+  }
+
+  if (framesNotRecorded > 0)
+  {
+    printf("frames not recorded: %llu\n", (unsigned long long)framesNotRecorded);
+  }
+
+  if (frameDump)
+  {
+    fclose(frameDump);
+    frameDump = NULL;
+  }
+}
+
+
+void DetectionPipeline::notifyFrame()
+{
+  {
+    std::lock_guard<std::mutex> lock(frameMutex);
+    pendingFrames += 1;
+  }
+  frameAvailable.notify_one();
+}
+
+
+void DetectionPipeline::resetSequence()
+{
+  resetRequested = true;
+  trackerResetRequested = true;
+}
+
+
+const FrameRing::Slot* DetectionPipeline::acquireFrame()
+{
+  //fast replay is there to see every frame, in order, however long it waited
+  const bool everyFrame = settings.pacing == MotionSettings::PaceFast;
+  for (;;)
+  {
+    const FrameRing::Slot* slot = frameRing->acquireRead();
+    if (!slot)
+    {
+      return NULL;
+    }
+
+    if (settings.backlogPolicy == MotionSettings::BacklogLatest && !everyFrame)
+    {
+      //following the present matters more than processing every frame
+      while (const FrameRing::Slot* newer = frameRing->acquireRead())
+      {
+        slot = newer;
+        framesSkipped += 1;
+      }
+    }
+
+    const double frameAgeMs = (FrameRing::nowUs() - slot->captureTimeUs) / 1000.0;
+    frameAgeFilter.add(frameAgeMs);
+    maxFrameAgeMs = std::max(maxFrameAgeMs, frameAgeMs);
+
+    if (!everyFrame && settings.maxFrameAgeMs > 0 && frameAgeMs > settings.maxFrameAgeMs)
+    {
+      //the eyes would look where someone was, not where they are
+      framesStale += 1;
+      frameRing->releaseRead();
+      continue;
+    }
+
+    return slot;
+  }
+}
+
+
+void DetectionPipeline::convertStage()
+{
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(frameMutex);
+      while (pendingFrames == 0 && !stopping)
+      {
+        frameAvailable.wait(lock);
+      }
+      if (stopping)
+      {
+        return;
+      }
+      pendingFrames = 0;
+    }
+
+    for (;;)
+    {
+      //waiting for a free frame is where back pressure ends up, the ring
+      //keeps dropping frames meanwhile and the newest one is taken below
+      DetectionFrame* frame;
+      if (!freeQueue.pop(frame))
+      {
+        return;
+      }
+      frame->references = 1;
+
+      const uint64_t allocationsBefore = AllocationCounter::threadAllocations();
+      const FrameRing::Slot* slot = acquireFrame();
+      if (!slot)
+      {
+        release(frame);
+        break;
+      }
+
+      framesTaken += 1;
+      if (!governor.processFrame(framesTaken))
+      {
+        framesShed += 1;
+        frameRing->releaseRead();
+        release(frame);
+        continue;
+      }
+
+      const int64_t workStartUs = FrameRing::nowUs();
+      try
+      {
+        convert(*slot, *frame);
+      }
+      catch (const cv::Exception& e)
+      {
+        cout<<"Caught Exception:" << e.what() <<endl;
+        frameRing->releaseRead();
+        release(frame);
+        continue;
+      }
+      //hand the buffer back to the capture thread
+      frameRing->releaseRead();
+      governor.addWork(FrameRing::nowUs() - workStartUs);
+      countAllocations(StageConvert, *frame, allocationsBefore);
+
+      if (!differenceQueue.push(frame))
+      {
+        return;
+      }
+    }
+  }
+}
+
+
+void DetectionPipeline::convert(const FrameRing::Slot& slot, DetectionFrame& frame)
+{
+  frames += 1;
+  if (frames % 100 == 0)
+  {
+    printStatistics();
+  }
+
+  frame.frameNumber = frames;
+  frame.pts = slot.pts;
+  frame.captureTimeUs = slot.captureTimeUs;
+  frame.processingStartUs = FrameRing::nowUs();
+  frame.hasThreshold = false;
+  frame.idle = false;
+  frame.illuminationChange = false;
+  frame.overBudget = false;
+  frame.resultReused = false;
+  frame.objectDetected = false;
+
+  const Size frameSize = slot.frameSize;
+  if (frameDump)
+  {
+    fwrite(slot.image.data, 1, FrameSource::frameBytes(frameSize, settings.captureFormat), frameDump);
+  }
+
+  if (settings.captureFormat == MotionSettings::CaptureLuma)
+  {
+    //the luma plane already is the gray scale image needed for frame differencing
+    Mat(frameSize.height * 3 / 2, frameSize.width, CV_8UC1, slot.image.data).copyTo(frame.raw);
+    const Mat luma = frame.raw.rowRange(0, frameSize.height);
+    if (frameSize == detectionSize)
+    {
+      frame.gray = luma;
+    }
+    else
+    {
+      cv::resize(luma, frame.scaledGray, detectionSize, 0, 0, INTER_AREA);
+      frame.gray = frame.scaledGray;
+    }
+  }
+  else
+  {
+    //convert the frame to gray scale for frame differencing
+    Mat(frameSize, CV_8UC3, slot.image.data).copyTo(frame.raw);
+    if (frameSize == detectionSize)
+    {
+      cv::cvtColor(frame.raw, frame.scaledGray, COLOR_BGR2GRAY);
+    }
+    else
+    {
+      cv::resize(frame.raw, frame.scaledColor, detectionSize, 0, 0, INTER_AREA);
+      cv::cvtColor(frame.scaledColor, frame.scaledGray, COLOR_BGR2GRAY);
+    }
+    frame.gray = frame.scaledGray;
+  }
+
+  cv::resize(frame.gray, frame.coarseGray, coarseSize, 0, 0, INTER_AREA);
+}
+
+
+void DetectionPipeline::differenceStage()
+{
+  //the previous frame stays referenced instead of copying its gray image
+  DetectionFrame* previous = NULL;
+  bool backgroundCurrent = true;
+  DetectionFrame* frame;
+  while (differenceQueue.pop(frame))
+  {
+    const uint64_t allocationsBefore = AllocationCounter::threadAllocations();
+    const int64_t workStartUs = FrameRing::nowUs();
+    if (resetRequested.exchange(false))
+    {
+      background.reset();
+      coarseBackground.reset();
+      if (previous)
+      {
+        release(previous);
+        previous = NULL;
+      }
+    }
+
+    //the governor may fall back to the previous frame, the background missed
+    //the frames meanwhile and starts over once it is back
+    const bool useBackground = settings.detectionMode == MotionSettings::DetectBackground &&
+                               governor.backgroundModel();
+    if (useBackground && !backgroundCurrent)
+    {
+      background.reset();
+      coarseBackground.reset();
+    }
+    backgroundCurrent = useBackground;
+
+    try
+    {
+      if (useBackground)
+      {
+        //the background replaces the previous frame, the coarse one learns along with it
+        const bool hasBackground = background.apply(frame->gray, backgroundImage);
+        coarseBackground.apply(frame->coarseGray, coarseBackgroundImage);
+        if (hasBackground && !computeMask(backgroundImage, coarseBackgroundImage, *frame))
+        {
+          //the light changed, the background starts over from this frame
+          background.reset();
+          coarseBackground.reset();
+          background.apply(frame->gray, backgroundImage);
+          coarseBackground.apply(frame->coarseGray, coarseBackgroundImage);
+        }
+      }
+      else if (previous)
+      {
+        //after a change of the light this frame is the next one's previous frame anyway
+        computeMask(previous->gray, previous->coarseGray, *frame);
+      }
+    }
+    catch (const cv::Exception& e)
+    {
+      cout<<"Caught Exception:" << e.what() <<endl;
+    }
+
+    //kept with the background model as well, in case the governor drops it
+    frame->references += 1;
+    if (previous)
+    {
+      release(previous);
+    }
+    previous = frame;
+    governor.addWork(FrameRing::nowUs() - workStartUs);
+    countAllocations(StageDifference, *frame, allocationsBefore);
+
+    if (!blobQueue.push(frame))
+    {
+      break;
+    }
+  }
+
+  if (previous)
+  {
+    release(previous);
+  }
+}
+
+
+bool DetectionPipeline::computeMask(const cv::Mat& reference, const cv::Mat& referenceCoarse, DetectionFrame& frame)
+{
+  //excluded and skipped cold tiles are not computed at all
+  const std::vector<uint8_t>* filter = tileFilter(frame);
+  bool coarseRegions = false;
+  if (referenceCoarse.size() == coarseSize)
+  {
+    //the coarse frames tell whether the light changed, and where anything moved
+    const bool changed = coarse.compare(referenceCoarse, frame.coarseGray, filter);
+    if (coarse.illuminationChanged())
+    {
+      frame.illuminationChange = true;
+      framesIlluminationChange += 1;
+      return false;
+    }
+
+    if (settings.coarseCheck)
+    {
+      coarseRegions = true;
+      frame.idle = !changed;
+      if (frame.idle)
+      {
+        framesIdle += 1;
+      }
+    }
+  }
+
+  if (!coarseRegions && !filter)
+  {
+    detector.computeThreshold(reference, frame.gray, frame.thresholdImage);
+    frame.hasThreshold = true;
+    return true;
+  }
+  if (!coarseRegions)
+  {
+    coarse.select(*filter);
+  }
+
+  detector.computeThreshold(reference, frame.gray, coarse.regions(), frame.thresholdImage);
+  if (roi.active())
+  {
+    roi.apply(frame.thresholdImage, coarse.regions());
+  }
+  frame.hasThreshold = true;
+  return true;
+}
+
+
+const std::vector<uint8_t>* DetectionPipeline::tileFilter(const DetectionFrame& frame)
+{
+  const bool skipCold = settings.autoRoi &&
+                        frame.frameNumber % ActivityHeatmap::COLD_PERIOD >= ActivityHeatmap::COLD_BURST;
+  if (!roi.active() && !skipCold)
+  {
+    return NULL;
+  }
+
+  if (roi.active())
+  {
+    filterTiles = roi.tiles();
+  }
+
+  if (skipCold)
+  {
+    //the blob stage swaps in new hot tiles, even their size is only read under the lock
+    std::lock_guard<std::mutex> lock(hotTilesMutex);
+    if (!roi.active())
+    {
+      filterTiles.assign(hotTiles.size(), 1);
+    }
+    for (size_t i = 0; i < filterTiles.size(); ++i)
+    {
+      filterTiles[i] = filterTiles[i] && hotTiles[i];
+    }
+  }
+  return &filterTiles;
+}
+
+
+void DetectionPipeline::blobStage()
+{
+  DetectionFrame* frame;
+  while (blobQueue.pop(frame))
+  {
+    const uint64_t allocationsBefore = AllocationCounter::threadAllocations();
+    const int64_t workStartUs = FrameRing::nowUs();
+    try
+    {
+      if (trackerResetRequested.exchange(false))
+      {
+        tracker.reset();
+        lastTracks.clear();
+        history.reset();
+        if (classifier)
+        {
+          classifier->reset();
+        }
+      }
+
+      frame->blobs.clear();
+      frame->tracks.clear();
+      frame->objectDetected = false;
+      frame->vx = 0;
+      frame->vy = 0;
+      const int64_t elapsedUs = FrameRing::nowUs() - frame->processingStartUs;
+      if (frame->hasThreshold && settings.frameBudgetMs > 0 && elapsedUs > settings.frameBudgetMs * 1000LL)
+      {
+        //the frames behind this one would be late as well, the tracker
+        //simply sees a longer gap until the next searched frame
+        //nothing was seen in this frame, it is no fresh detection
+        frame->tracks = lastTracks;
+        for (size_t i = 0; i < frame->tracks.size(); ++i)
+        {
+          frame->tracks[i].updated = false;
+        }
+        frame->resultReused = true;
+        framesReused += 1;
+        history.advance(frame->pts);
+      }
+      else if (frame->hasThreshold)
+      {
+        //one target needs only the moments of the mask, several are told apart by labelling it.
+        //New objects in cold tiles are only visible during a burst, all of it is searched
+        const bool coldBurst = settings.autoRoi &&
+                               frame->frameNumber % ActivityHeatmap::COLD_PERIOD < ActivityHeatmap::COLD_BURST;
+        const Rect searchRect = tracker.predict(frame->pts, frame->thresholdImage.size(), coldBurst);
+        if (frame->idle)
+        {
+          //nothing changed, there is nothing to search
+        }
+        else if (settings.targetMode == MotionSettings::TargetSingle)
+        {
+          detector.measureMovement(frame->thresholdImage, searchRect, frame->blobs);
+        }
+        else
+        {
+          detector.searchForMovement(frame->thresholdImage, searchRect, frame->blobs);
+          if (detector.capped())
+          {
+            framesCapped += 1;
+          }
+        }
+        //the ages measured below count from this frame, with or without motion
+        if (frame->idle)
+        {
+          history.advance(frame->pts);
+        }
+        else
+        {
+          history.update(frame->thresholdImage, frame->pts);
+        }
+        tracker.update(frame->blobs, frame->tracks);
+        if (classifier)
+        {
+          classifier->submit(frame->gray, frame->tracks, frame->pts);
+        }
+        lastTracks = frame->tracks;
+
+        if (!settings.heatmapFile.empty() || settings.autoRoi)
+        {
+          heatmap.add(frame->tracks, frame->blobs);
+          updateHeatmap(frame->frameNumber);
+        }
+      }
+
+      if (frame->hasThreshold)
+      {
+        if (classifier)
+        {
+          classifier->apply(frame->tracks);
+        }
+        const Track* primary = primaryTrack(frame->tracks);
+        if (primary)
+        {
+          frame->objectId = primary->id;
+          frame->x = uint32_t(std::max(0, cvRound(primary->x)));
+          frame->y = uint32_t(std::max(0, cvRound(primary->y)));
+          frame->objectBoundingRectangle = primary->boundingRect;
+          history.measure(primary->boundingRect, frame->vx, frame->vy);
+        }
+        for (size_t i = 0; i < frame->tracks.size(); ++i)
+        {
+          const Track& track = frame->tracks[i];
+          frame->objectDetected = frame->objectDetected || (track.updated && track.kind != Track::KindOther);
+        }
+      }
+    }
+    catch (const cv::Exception& e)
+    {
+      cout<<"Caught Exception:" << e.what() <<endl;
+    }
+
+    frame->processingTimeMs = (FrameRing::nowUs() - frame->processingStartUs) / 1000.0;
+    if (settings.frameBudgetMs > 0 && frame->processingTimeMs > settings.frameBudgetMs)
+    {
+      frame->overBudget = true;
+      framesOverBudget += 1;
+    }
+    const int64_t nowUs = FrameRing::nowUs();
+    governor.addWork(nowUs - workStartUs);
+    //skipping to the newest frame is how BacklogLatest keeps up, it is no loss
+    governor.update(nowUs, frameRing->droppedOldestCount() + frameRing->droppedNewestCount() + framesStale,
+                    frameRing->size());
+    countAllocations(StageBlobs, *frame, allocationsBefore);
+
+    if (!publishQueue.push(frame))
+    {
+      return;
+    }
+  }
+}
+
+
+const Track* DetectionPipeline::primaryTrack(const std::vector<Track>& tracks) const
+{
+  //ids grow, the smallest has been followed longest, tracks the classifier
+  //rejected do not count
+  const Track* result = NULL;
+  for (size_t i = 0; i < tracks.size(); ++i)
+  {
+    const Track& track = tracks[i];
+    if (track.kind != Track::KindOther && (!result || track.id < result->id))
+    {
+      result = &track;
+    }
+  }
+  return result;
+}
+
+
+void DetectionPipeline::updateHeatmap(uint32_t frameNumber)
+{
+  if (frameNumber % HOT_TILES_INTERVAL == 0)
+  {
+    heatmap.hotTiles(nextHotTiles);
+    std::lock_guard<std::mutex> lock(hotTilesMutex);
+    hotTiles.swap(nextHotTiles);
+  }
+
+  if (frameNumber % HEATMAP_SAVE_INTERVAL == 0 && !settings.heatmapFile.empty())
+  {
+    heatmap.save(settings.heatmapFile);
+  }
+}
+
+
+void DetectionPipeline::publishStage()
+{
+  DetectionFrame* frame;
+  while (publishQueue.pop(frame))
+  {
+    const uint64_t allocationsBefore = AllocationCounter::threadAllocations();
+    publishCallback(*frame);
+    countAllocations(StagePublish, *frame, allocationsBefore);
+
+    //never wait for the disk, a frame that does not fit is not recorded
+    if (!governor.recording() || !recordPredicate(*frame))
+    {
+      release(frame);
+    }
+    else if (!recordQueue.tryPush(frame))
+    {
+      framesNotRecorded += 1;
+      release(frame);
+    }
+  }
+}
+
+
+void DetectionPipeline::recordStage()
+{
+  DetectionFrame* frame;
+  while (recordQueue.pop(frame))
+  {
+    const uint64_t allocationsBefore = AllocationCounter::threadAllocations();
+    const int64_t workStartUs = FrameRing::nowUs();
+    try
+    {
+      recordCallback(*frame);
+    }
+    catch (const cv::Exception& e)
+    {
+      cout<<"Caught Exception:" << e.what() <<endl;
+    }
+    governor.addWork(FrameRing::nowUs() - workStartUs);
+    countAllocations(StageRecord, *frame, allocationsBefore);
+    release(frame);
+  }
+}
+
+
+void DetectionPipeline::release(DetectionFrame* frame)
+{
+  //the pool and the free queue have the same size, this never blocks
+  if (frame->references.fetch_sub(1) == 1)
+  {
+    freeQueue.tryPush(frame);
+  }
+}
+
+
+void DetectionPipeline::countAllocations(Stage stage, const DetectionFrame& frame, uint64_t allocationsBefore)
+{
+  if (frame.frameNumber > WARM_UP_FRAMES)
+  {
+    stageAllocations[stage] += AllocationCounter::threadAllocations() - allocationsBefore;
+  }
+}
+
+
+void DetectionPipeline::printStatistics()
+{
+  printf("frame %d, dropped oldest %llu, dropped newest %llu, skipped %llu, stale %llu, not recorded %llu, "
+         "idle %llu, light changes %llu, over budget %llu, reused %llu, capped %llu, shed %llu, "
+         "load %d%% step %u, age avg %4.2lfms max %4.2lfms\n", frames,
+         (unsigned long long)frameRing->droppedOldestCount(),
+         (unsigned long long)frameRing->droppedNewestCount(),
+         (unsigned long long)framesSkipped, (unsigned long long)framesStale,
+         (unsigned long long)framesNotRecorded, (unsigned long long)framesIdle,
+         (unsigned long long)framesIlluminationChange, (unsigned long long)framesOverBudget,
+         (unsigned long long)framesReused, (unsigned long long)framesCapped,
+         (unsigned long long)framesShed, governor.load(), governor.level(),
+         frameAgeFilter.avg(), maxFrameAgeMs);
+  if (AllocationCounter::enabled())
+  {
+    printf("allocations after warm up: convert %llu, difference %llu, blobs %llu, publish %llu, record %llu\n",
+           (unsigned long long)stageAllocations[StageConvert], (unsigned long long)stageAllocations[StageDifference],
+           (unsigned long long)stageAllocations[StageBlobs], (unsigned long long)stageAllocations[StagePublish],
+           (unsigned long long)stageAllocations[StageRecord]);
+  }
+  maxFrameAgeMs = 0;
+}
@@ -0,0 +1,314 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef DETECTION_PIPELINE_H_INCLUDED
+#define DETECTION_PIPELINE_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BackgroundModel.h"
+#include "BandPool.h"
+#include "ActivityHeatmap.h"
+#include "BoundedQueue.h"
+#include "CoarseMotion.h"
+#include "FrameRing.h"
+#include "LoadGovernor.h"
+#include "MotionDetector.h"
+#include "MotionHistory.h"
+#include "MotionSettings.h"
+#include "MotionTracker.h"
+#include "PersonClassifier.h"
+#include "RegionOfInterest.h"
+#include "SMA.h"
+
+/**
+   Everything known about one captured frame while it travels through the
+   pipeline. A fixed pool of these is allocated once and recycled, so the
+   image buffers inside are reused from frame to frame.
+
+   A frame returns to the pool once nobody references it any more. Besides
+   the stage it is in, the difference stage keeps a reference to the frame
+   it uses as previous image.
+ */
+struct DetectionFrame
+{
+  DetectionFrame()
+    : references(0), frameNumber(0), pts(0), captureTimeUs(0), processingStartUs(0), processingTimeMs(0),
+    hasThreshold(false), idle(false), illuminationChange(false), overBudget(false), resultReused(false),
+    objectDetected(false), x(0), y(0), vx(0), vy(0), objectId(0)
+  { }
+
+
+  std::atomic<int> references;
+
+
+  uint32_t frameNumber;
+  int64_t pts;
+  int64_t captureTimeUs;
+  int64_t processingStartUs;
+  double processingTimeMs;
+
+  //copy of the frame as captured, planar I420 or packed BGR
+  cv::Mat raw;
+  //gray scale image at detection size, may point into raw
+  cv::Mat gray;
+  cv::Mat scaledGray;
+  //colour frame scaled to detection size, CaptureColor only
+  cv::Mat scaledColor;
+  //gray reduced by CoarseMotion::FACTOR
+  cv::Mat coarseGray;
+
+  //binary motion mask, only valid if hasThreshold
+  cv::Mat thresholdImage;
+  bool hasThreshold;
+  //the coarse check found no change, thresholdImage is empty
+  bool idle;
+  //the light changed all over the frame, there is no threshold image
+  bool illuminationChange;
+  //processing took longer than MotionSettings::frameBudgetMs
+  bool overBudget;
+  //the budget was spent before the blob search, tracks are the previous frame's,
+  //none of them counts as updated
+  bool resultReused;
+
+  //the object is the confirmed track followed longest, x and y are its
+  //filtered position, objectDetected if any confirmed track was seen,
+  //tracks classified as Track::KindOther do not count
+  bool objectDetected;
+  uint32_t x;
+  uint32_t y;
+  //where the object is heading in pixels per second, see MotionHistory
+  double vx;
+  double vy;
+  cv::Rect objectBoundingRectangle;
+  uint32_t objectId;
+  //everything that moved in the search region, largest first
+  std::vector<Blob> blobs;
+  //all confirmed tracks, see MotionTracker
+  std::vector<Track> tracks;
+};
+
+
+/**
+   Runs the motion detection as a chain of stages, each on its own thread,
+   connected by bounded queues:
+
+   convert -> difference -> blobs -> publish -> record
+
+   - convert takes frames from the FrameRing according to the backlog policy
+     and copies them into a DetectionFrame together with their gray image,
+     only every few frames if the LoadGovernor stepped down
+   - difference builds the threshold image against the previous frame, or
+     against the background with MotionSettings::DetectBackground, and
+     only inside the RegionOfInterest and where CoarseMotion finds a change,
+     tiles the ActivityHeatmap never saw tracks in only in short bursts.
+     A frame in which the light changed gets no threshold image at all and
+     becomes the new reference
+   - blobs searches the threshold image for moving objects and follows them
+     with the MotionTracker, only where the tracker expects them most of
+     the time, and tells the object's direction from the MotionHistory.
+     With MotionSettings::classifyPeople the tracks are handed to the
+     PersonClassifier, its results arrive some frames later. A frame that
+     spent MotionSettings::frameBudgetMs before it got there keeps the
+     previous frame's tracks instead, so the frames queued behind a slow
+     one catch up within a frame
+   - publish hands the result to the publish callback
+   - record hands frames the record predicate selected to the record callback
+
+   Frames only enter the pipeline when a DetectionFrame is free, and a full
+   queue blocks the stage in front of it, so a slow stage throttles the
+   pipeline instead of growing a backlog. Meanwhile the FrameRing drops
+   frames according to its overflow policy.
+
+   The record stage is the exception: disk writes may stall for seconds, so
+   frames that do not fit into its queue are not recorded and counted in
+   framesNotRecorded, detection carries on. stop() lets the record stage
+   write what is queued before it returns.
+ */
+class DetectionPipeline
+{
+public:
+
+  typedef std::function<void(DetectionFrame&)> PublishCallback;
+  typedef std::function<bool(const DetectionFrame&)> RecordPredicate;
+  typedef std::function<void(DetectionFrame&)> RecordCallback;
+
+  DetectionPipeline(const MotionSettings& settings, const cv::Size& detectionSize,
+                    const std::shared_ptr<FrameRing>& ring);
+  virtual ~DetectionPipeline();
+
+  void start(const PublishCallback& publish, const RecordPredicate& wantsRecording, const RecordCallback& record);
+  /** Ends the stages and saves the heatmap, only the first call does anything. */
+  void stop();
+
+  /** Called by the frame source after every frame it committed to the ring. */
+  void notifyFrame();
+
+  /** Drops the previous frame and all tracks, the next frame starts a new difference sequence. */
+  void resetSequence();
+
+  //frames passed over for a newer one (MotionSettings::BacklogLatest)
+  std::atomic<uint64_t> framesSkipped;
+  //frames dropped for exceeding MotionSettings::maxFrameAgeMs
+  std::atomic<uint64_t> framesStale;
+  //frames the record stage had no room for
+  std::atomic<uint64_t> framesNotRecorded;
+  //frames the coarse check found no change in
+  std::atomic<uint64_t> framesIdle;
+  //frames skipped for a change of the light, see CoarseMotion::illuminationChanged()
+  std::atomic<uint64_t> framesIlluminationChange;
+  //frames processed slower than MotionSettings::frameBudgetMs
+  std::atomic<uint64_t> framesOverBudget;
+  //frames that reused the previous result to catch up
+  std::atomic<uint64_t> framesReused;
+  //frames too noisy to label, see MotionDetector::capped()
+  std::atomic<uint64_t> framesCapped;
+  //frames the LoadGovernor let pass unprocessed
+  std::atomic<uint64_t> framesShed;
+
+  enum Stage
+  {
+    StageConvert,
+    StageDifference,
+    StageBlobs,
+    StagePublish,
+    StageRecord,
+    STAGE_COUNT
+  };
+
+  //heap allocations of each stage after the warm up, see AllocationCounter
+  std::atomic<uint64_t> stageAllocations[STAGE_COUNT];
+
+private:
+
+  DetectionPipeline(const DetectionPipeline&);
+  DetectionPipeline& operator=(const DetectionPipeline&);
+
+  //capacity of the queues between two stages
+  static const unsigned int QUEUE_CAPACITY = 2;
+  //frames that may wait for the record stage, about a third of a second
+  static const unsigned int RECORD_QUEUE_CAPACITY = 8;
+  //number of frames that may be in flight at the same time, frames waiting
+  //to be recorded must not starve the detection stages, one more is the
+  //previous image of the difference stage
+  static const unsigned int POOL_SIZE = 6 + RECORD_QUEUE_CAPACITY + 1 + 1;
+  //frames between updates of the cold tiles from the heatmap
+  static const uint32_t HOT_TILES_INTERVAL = 250;
+  //frames between saves of the heatmap, about ten minutes
+  static const uint32_t HEATMAP_SAVE_INTERVAL = 15000;
+  //frames until all buffers have their final size, allocations are counted after that
+  static const uint32_t WARM_UP_FRAMES = 2 * POOL_SIZE;
+
+  void convertStage();
+  void differenceStage();
+  void blobStage();
+  void publishStage();
+  void recordStage();
+
+  const FrameRing::Slot* acquireFrame();
+  void convert(const FrameRing::Slot& slot, DetectionFrame& frame);
+  bool computeMask(const cv::Mat& reference, const cv::Mat& referenceCoarse, DetectionFrame& frame);
+  const std::vector<uint8_t>* tileFilter(const DetectionFrame& frame);
+  void updateHeatmap(uint32_t frameNumber);
+  const Track* primaryTrack(const std::vector<Track>& tracks) const;
+  void release(DetectionFrame* frame);
+  void countAllocations(Stage stage, const DetectionFrame& frame, uint64_t allocationsBefore);
+  void printStatistics();
+
+  const MotionSettings settings;
+  const cv::Size detectionSize;
+  const cv::Size coarseSize;
+  const std::shared_ptr<FrameRing> frameRing;
+
+  PublishCallback publishCallback;
+  RecordPredicate recordPredicate;
+  RecordCallback recordCallback;
+
+  std::vector<DetectionFrame> pool;
+  BoundedQueue<DetectionFrame*> freeQueue;
+  BoundedQueue<DetectionFrame*> differenceQueue;
+  BoundedQueue<DetectionFrame*> blobQueue;
+  BoundedQueue<DetectionFrame*> publishQueue;
+  BoundedQueue<DetectionFrame*> recordQueue;
+
+  std::vector<std::thread> threads;
+
+  //frame notifications from the frame source
+  std::mutex frameMutex;
+  std::condition_variable frameAvailable;
+  uint64_t pendingFrames;
+  bool stopping;
+
+  //threads the difference and blob stages split their per pixel work on
+  BandPool bandPool;
+  //fed by all stages, updated by the blob stage
+  LoadGovernor governor;
+
+  //state of the difference stage, the blob stage only uses the
+  //detector's blob workspace
+  MotionDetector detector;
+  std::atomic<bool> resetRequested;
+  BackgroundModel background;
+  cv::Mat backgroundImage;
+  CoarseMotion coarse;
+  RegionOfInterest roi;
+  BackgroundModel coarseBackground;
+  cv::Mat coarseBackgroundImage;
+  //tiles computed in the current frame
+  std::vector<uint8_t> filterTiles;
+
+  //state of the blob stage
+  MotionTracker tracker;
+  std::atomic<bool> trackerResetRequested;
+  //result of the last frame that was searched
+  std::vector<Track> lastTracks;
+  MotionHistory history;
+  //MotionSettings::classifyPeople only
+  std::unique_ptr<PersonClassifier> classifier;
+  ActivityHeatmap heatmap;
+  std::vector<uint8_t> nextHotTiles;
+
+  //tiles with tracks according to the heatmap, from the blob to the difference stage
+  std::mutex hotTilesMutex;
+  std::vector<uint8_t> hotTiles;
+
+  //state of the convert stage
+  uint32_t frames;
+  //frames taken from the ring, processed or not
+  uint64_t framesTaken;
+  //time frames spent between capture and the start of their processing
+  SMA frameAgeFilter;
+  double maxFrameAgeMs;
+  //raw copy of every captured frame, can be replayed with a "raw:" source
+  FILE* frameDump;
+};
+
+
+#endif
@@ -0,0 +1,216 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "EventIndex.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "EyeMapping.h"
+
+namespace
+{
+
+// text as a JSON string literal, file names may contain quotes and backslashes
+std::string jsonString(const std::string& text)
+{
+  std::string result = "\"";
+  for (size_t i = 0; i < text.size(); ++i)
+  {
+    const unsigned char c = text[i];
+    if (c == '"' || c == '\\')
+    {
+      result += '\\';
+      result += c;
+    }
+    else if (c < 0x20)
+    {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      result += escaped;
+    }
+    else
+    {
+      result += c;
+    }
+  }
+  return result + "\"";
+}
+
+}
+
+EventIndex::EventIndex(const std::string& fileName, const std::string& defaultExtension)
+  : segmentNumber(0),
+  active(false),
+  opened(0),
+  startPts(0),
+  frameRate(0),
+  hasMotion(false),
+  motionStartPts(0),
+  motionEndPts(0)
+{
+  const size_t dot = fileName.find_last_of('.');
+  const size_t slash = fileName.find_last_of('/');
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+  {
+    baseName = fileName.substr(0, dot);
+    extension = fileName.substr(dot);
+  }
+  else
+  {
+    baseName = fileName;
+    extension = defaultExtension;
+  }
+  indexFileName = baseName + ".index.jsonl";
+}
+
+
+std::string EventIndex::beginEvent(int64_t startPts_, double frameRate_)
+{
+  if (active)
+  {
+    endEvent();
+  }
+
+  segmentNumber += 1;
+  char number[16];
+  snprintf(number, sizeof(number), "-%04u", segmentNumber);
+  segmentFile = baseName + number + extension;
+
+  active = true;
+  opened = time(NULL);
+  startPts = startPts_;
+  frameRate = frameRate_;
+  framePts.clear();
+  hasMotion = false;
+  peakBox = cv::Rect();
+  return segmentFile;
+}
+
+
+void EventIndex::addFrame(int64_t pts)
+{
+  if (active)
+  {
+    framePts.push_back(pts);
+  }
+}
+
+
+void EventIndex::addMotion(int64_t pts, const cv::Rect& objectBoundingRectangle)
+{
+  if (!active || pts < startPts)
+  {
+    return;
+  }
+
+  if (!hasMotion)
+  {
+    hasMotion = true;
+    motionStartPts = pts;
+    motionEndPts = pts;
+  }
+  motionStartPts = std::min(motionStartPts, pts);
+  motionEndPts = std::max(motionEndPts, pts);
+
+  if (objectBoundingRectangle.area() > peakBox.area())
+  {
+    peakBox = objectBoundingRectangle;
+  }
+}
+
+
+void EventIndex::endEvent()
+{
+  if (!active)
+  {
+    return;
+  }
+  active = false;
+
+  // frames are written in decoding order, their pts are not necessarily sorted
+  std::sort(framePts.begin(), framePts.end());
+  const int64_t endPts = framePts.empty() ? startPts : framePts.back();
+  if (!hasMotion)
+  {
+    motionStartPts = motionEndPts = startPts;
+  }
+  const long motionStartFrame = std::lower_bound(framePts.begin(), framePts.end(), motionStartPts) - framePts.begin();
+  const long motionEndFrame = std::lower_bound(framePts.begin(), framePts.end(), motionEndPts) - framePts.begin();
+
+  double motionStartMs = (motionStartPts - startPts) / 1000.0;
+  double motionEndMs = (motionEndPts - startPts) / 1000.0;
+  double endMs = (endPts - startPts) / 1000.0;
+  if (frameRate > 0)
+  {
+    //the player shows frame n at n / frameRate, whatever the pts said
+    motionStartMs = motionStartFrame * 1000.0 / frameRate;
+    motionEndMs = motionEndFrame * 1000.0 / frameRate;
+    endMs = framePts.empty() ? 0.0 : (framePts.size() - 1) * 1000.0 / frameRate;
+  }
+
+  // an event without motion has no motion times and no box to point the eyes at
+  char motion[512] = "\"motion_start_ms\":null,\"motion_end_ms\":null,"
+                     "\"motion_start_frame\":null,\"motion_end_frame\":null,\"peak_area\":0,"
+                     "\"peak_box\":null,\"peak_x\":null,\"peak_y\":null,\"eye_x\":null,\"eye_y\":null";
+  if (hasMotion)
+  {
+    const int peakX = peakBox.x + peakBox.width / 2;
+    const int peakY = peakBox.y + peakBox.height / 2;
+    double xEye;
+    double yEye;
+    cameraToEye(peakX, peakY, xEye, yEye);
+    snprintf(motion, sizeof(motion), "\"motion_start_ms\":%.1f,\"motion_end_ms\":%.1f,"
+             "\"motion_start_frame\":%ld,\"motion_end_frame\":%ld,\"peak_area\":%d,"
+             "\"peak_box\":[%d,%d,%d,%d],\"peak_x\":%d,\"peak_y\":%d,\"eye_x\":%.3f,\"eye_y\":%.3f",
+             motionStartMs, motionEndMs, motionStartFrame, motionEndFrame, peakBox.area(),
+             peakBox.x, peakBox.y, peakBox.width, peakBox.height, peakX, peakY, xEye, yEye);
+  }
+
+  char openedText[32];
+  strftime(openedText, sizeof(openedText), "%Y-%m-%d %H:%M:%S", localtime(&opened));
+
+  // only the name, the index lives next to the segments
+  const size_t slash = segmentFile.find_last_of('/');
+  const std::string file = slash == std::string::npos ? segmentFile : segmentFile.substr(slash + 1);
+
+  FILE* index = fopen(indexFileName.c_str(), "a");
+  if (!index)
+  {
+    printf("recorder: could not append to '%s'\n", indexFileName.c_str());
+    return;
+  }
+  fprintf(index, "{\"file\":%s,\"opened\":\"%s\",\"frames\":%u,\"end_ms\":%.1f,%s}\n",
+          jsonString(file).c_str(), openedText, (unsigned)framePts.size(), endMs, motion);
+  fclose(index);
+}
+
+
+void EventIndex::abortEvent()
+{
+  active = false;
+}
+
+
+bool EventIndex::inEvent() const
+{
+  return active;
+}
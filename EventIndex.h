@@ -0,0 +1,102 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef EVENT_INDEX_H_INCLUDED
+#define EVENT_INDEX_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+/**
+   Names the per-event segment files of a recording and appends one line of
+   JSON per finished event to the index file next to them, so review tools
+   can seek to the events without decoding the whole night.
+
+   For the output file capture.mkv the segments are capture-0001.mkv,
+   capture-0002.mkv, ... and the index is capture.index.jsonl. A line looks
+   like
+
+   {"file":"capture-0001.mkv","opened":"2016-10-30 22:31:05","frames":212,
+    "end_ms":8480.0,"motion_start_ms":3040.0,"motion_end_ms":6480.0,
+    "motion_start_frame":76,"motion_end_frame":162,"peak_area":2310,
+    "peak_box":[141,88,42,55],"peak_x":162,"peak_y":115,"eye_x":0.41,"eye_y":0.37}
+
+   Times are milliseconds and frame numbers count from the start of the
+   segment file, boxes and positions are in detection coordinates. For
+   containers with a constant frame rate the times are the playback
+   positions of the frames, derived from their numbers, otherwise they are
+   taken from the pts. An event without motion has null motion times, box,
+   position and eye position. The index is only appended to, every line is
+   written when its event ends.
+
+   Not thread safe, each recorder uses it from its writer thread only.
+ */
+class EventIndex
+{
+public:
+
+  EventIndex(const std::string& fileName, const std::string& defaultExtension);
+
+  /**
+     Starts a new event, returns the file name for its segment. frameRate
+     is the one the segment is written with, 0 if it keeps the timestamps.
+   */
+  std::string beginEvent(int64_t startPts, double frameRate = 0);
+
+  /** A frame with pts was written to the segment. */
+  void addFrame(int64_t pts);
+
+  /** Detection result for the frame with pts, frames and boxes may arrive in any order. */
+  void addMotion(int64_t pts, const cv::Rect& objectBoundingRectangle);
+
+  /** Appends the line of the current event to the index. */
+  void endEvent();
+
+  /** Forgets the current event, e.g. if its segment could not be written. */
+  void abortEvent();
+
+  bool inEvent() const;
+
+private:
+
+  std::string baseName;
+  std::string extension;
+  std::string indexFileName;
+  unsigned int segmentNumber;
+
+  bool active;
+  std::string segmentFile;
+  time_t opened;
+  int64_t startPts;
+  double frameRate;
+  //pts of the frames written so far, to turn times into frame numbers
+  std::vector<int64_t> framePts;
+  bool hasMotion;
+  int64_t motionStartPts;
+  int64_t motionEndPts;
+  cv::Rect peakBox;
+};
+
+
+#endif
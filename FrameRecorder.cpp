@@ -0,0 +1,245 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "FrameRecorder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace cv;
+
+FrameRecorder::FrameRecorder(const std::string& fileName, const cv::Size& size_, const MotionSettings& settings_)
+  : settings(settings_),
+  size(size_),
+  eventIndex(fileName, ".avi"),
+  preRollHead(0),
+  preRollCount(0),
+  triggered(false),
+  firstMotionPts(0),
+  lastMotionPts(0),
+  hasLastPts(false),
+  lastPts(0)
+{ }
+
+
+FrameRecorder::~FrameRecorder()
+{
+  close();
+}
+
+
+void FrameRecorder::addFrame(const cv::Mat& raw, int64_t pts, bool objectDetected,
+                             const cv::Rect& objectBoundingRectangle)
+{
+  if (preRoll.empty())
+  {
+    allocatePreRoll(raw);
+  }
+
+  //a looped file or a reconnected stream starts over with other pts, the
+  //event and the pre-roll belong to the old sequence
+  if (hasLastPts && (pts < lastPts || pts > lastPts + settings.postTriggerMs * 1000LL))
+  {
+    if (triggered)
+    {
+      triggered = false;
+      closeSegment();
+    }
+    preRollHead = 0;
+    preRollCount = 0;
+  }
+  hasLastPts = true;
+  lastPts = pts;
+
+  if (objectDetected)
+  {
+    if (!triggered)
+    {
+      firstMotionPts = pts;
+    }
+    triggered = true;
+    lastMotionPts = pts;
+  }
+  else if (triggered && pts > lastMotionPts + settings.postTriggerMs * 1000LL)
+  {
+    triggered = false;
+    closeSegment();
+  }
+
+  if (triggered)
+  {
+    const int64_t startPts = firstMotionPts - settings.preTriggerMs * 1000LL;
+    if (!eventIndex.inEvent())
+    {
+      openSegment(startPts, pts);
+    }
+    writePreRoll(startPts);
+    write(raw, pts, objectDetected, objectBoundingRectangle);
+    return;
+  }
+
+  // the oldest frame is overwritten, its buffer is reused
+  BufferedFrame& buffered = preRoll[(preRollHead + preRollCount) % preRoll.size()];
+  if (preRollCount == preRoll.size())
+  {
+    preRollHead = (preRollHead + 1) % preRoll.size();
+  }
+  else
+  {
+    preRollCount += 1;
+  }
+  raw.copyTo(buffered.raw);
+  buffered.pts = pts;
+  buffered.objectDetected = objectDetected;
+  buffered.objectBoundingRectangle = objectBoundingRectangle;
+}
+
+
+void FrameRecorder::close()
+{
+  closeSegment();
+}
+
+
+void FrameRecorder::openSegment(int64_t startPts, int64_t pts)
+{
+  // the segment starts with the oldest pre-roll frame that gets written
+  int64_t firstPts = pts;
+  for (size_t i = 0; i < preRollCount; ++i)
+  {
+    const BufferedFrame& buffered = preRoll[(preRollHead + i) % preRoll.size()];
+    if (buffered.pts >= startPts)
+    {
+      firstPts = buffered.pts;
+      break;
+    }
+  }
+
+  const double frameRate = preRollFrameRate();
+  const std::string fileName = eventIndex.beginEvent(firstPts, frameRate);
+  writer.open(fileName, CV_FOURCC('X', 'V', 'I', 'D'), frameRate, size, true);
+  if (!writer.isOpened())
+  {
+    printf("recorder: could not open '%s'\n", fileName.c_str());
+  }
+  else
+  {
+    printf("recorder: started '%s' at %.1lf fps\n", fileName.c_str(), frameRate);
+  }
+}
+
+
+double FrameRecorder::preRollFrameRate() const
+{
+  //the frames that actually reached the recorder, shed and skipped ones are missing
+  if (preRollCount >= 2)
+  {
+    const int64_t firstPts = preRoll[preRollHead].pts;
+    const int64_t lastPts = preRoll[(preRollHead + preRollCount - 1) % preRoll.size()].pts;
+    if (lastPts > firstPts)
+    {
+      return (preRollCount - 1) * 1000000.0 / (lastPts - firstPts);
+    }
+  }
+  return settings.frameRate;
+}
+
+
+void FrameRecorder::closeSegment()
+{
+  if (writer.isOpened())
+  {
+    writer.release();
+    eventIndex.endEvent();
+  }
+  else
+  {
+    eventIndex.abortEvent();
+  }
+}
+
+
+void FrameRecorder::allocatePreRoll(const cv::Mat& raw)
+{
+  const size_t frameBytes = std::max<size_t>(1, raw.total() * raw.elemSize());
+  const size_t byMemory = (size_t)settings.preRollMemoryMb * 1024 * 1024 / frameBytes;
+  const size_t byTime = (size_t)std::ceil(settings.preTriggerMs / 1000.0 * settings.frameRate);
+  const size_t frames = std::max<size_t>(1, std::min(byMemory, byTime));
+
+  preRoll.resize(frames);
+  for (size_t i = 0; i < preRoll.size(); ++i)
+  {
+    preRoll[i].raw.create(raw.rows, raw.cols, raw.type());
+  }
+  printf("recorder: pre-roll of %u frames, %u kB\n", (unsigned)frames, (unsigned)(frames * frameBytes / 1024));
+}
+
+
+void FrameRecorder::writePreRoll(int64_t startPts)
+{
+  for (; preRollCount > 0; --preRollCount)
+  {
+    const BufferedFrame& buffered = preRoll[preRollHead];
+    if (buffered.pts >= startPts)
+    {
+      write(buffered.raw, buffered.pts, buffered.objectDetected, buffered.objectBoundingRectangle);
+    }
+    preRollHead = (preRollHead + 1) % preRoll.size();
+  }
+  preRollHead = 0;
+}
+
+
+void FrameRecorder::write(const cv::Mat& raw, int64_t pts, bool objectDetected,
+                          const cv::Rect& objectBoundingRectangle)
+{
+  if (!writer.isOpened())
+  {
+    return;
+  }
+
+  //the colour frame is only needed here, so it is produced on demand
+  if (settings.captureFormat == MotionSettings::CaptureLuma)
+  {
+    cv::cvtColor(raw, colorImage, COLOR_YUV2BGR_I420);
+  }
+  else
+  {
+    colorImage = raw;
+  }
+  if (colorImage.size() != size)
+  {
+    cv::resize(colorImage, colorImageSmall, size, 0, 0, INTER_AREA);
+  }
+  else
+  {
+    colorImage.copyTo(colorImageSmall);
+  }
+
+  if (objectDetected)
+  {
+    rectangle(colorImageSmall, objectBoundingRectangle, Scalar(255, 255, 0));
+    eventIndex.addMotion(pts, objectBoundingRectangle);
+  }
+  writer.write(colorImageSmall);
+  eventIndex.addFrame(pts);
+}
@@ -0,0 +1,108 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef FRAME_RECORDER_H_INCLUDED
+#define FRAME_RECORDER_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <opencv/highgui.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "EventIndex.h"
+#include "MotionSettings.h"
+
+/**
+   Records motion events from the decoded frames, with the bounding box of
+   the object drawn in, encoded with XVID into one file per event. The files
+   are named and indexed by EventIndex, e.g. capture.avi records
+   capture-0001.avi, capture-0002.avi, ... and capture.index.jsonl.
+
+   Every processed frame is handed over with addFrame(). Between events the
+   frames of the last MotionSettings::preTriggerMs are kept in a pre-roll of
+   preallocated buffers, limited to MotionSettings::preRollMemoryMb. When
+   motion is seen the pre-roll is written first, then every frame until no
+   motion was seen for MotionSettings::postTriggerMs, so an event is one
+   continuous clip even if the detection flickers.
+
+   AVI has a constant frame rate, each segment is written with the rate
+   the frames of its pre-roll arrived at, which is lower than the camera's
+   if the detection skipped frames.
+ */
+class FrameRecorder
+{
+public:
+
+  FrameRecorder(const std::string& fileName, const cv::Size& size, const MotionSettings& settings);
+  virtual ~FrameRecorder();
+
+  /** Called for every processed frame in order, raw is planar I420 or packed BGR like DetectionFrame::raw. */
+  void addFrame(const cv::Mat& raw, int64_t pts, bool objectDetected, const cv::Rect& objectBoundingRectangle);
+
+  void close();
+
+private:
+
+  FrameRecorder(const FrameRecorder&);
+  FrameRecorder& operator=(const FrameRecorder&);
+
+  struct BufferedFrame
+  {
+    cv::Mat raw;
+    int64_t pts;
+    bool objectDetected;
+    cv::Rect objectBoundingRectangle;
+  };
+
+  void allocatePreRoll(const cv::Mat& raw);
+  void openSegment(int64_t startPts, int64_t pts);
+  double preRollFrameRate() const;
+  void closeSegment();
+  void writePreRoll(int64_t startPts);
+  void write(const cv::Mat& raw, int64_t pts, bool objectDetected, const cv::Rect& objectBoundingRectangle);
+
+  const MotionSettings settings;
+  const cv::Size size;
+  //the segment of the current event, closed between events
+  cv::VideoWriter writer;
+  EventIndex eventIndex;
+
+  //ring of frames waiting for an event, allocated with the first frame
+  std::vector<BufferedFrame> preRoll;
+  size_t preRollHead;
+  size_t preRollCount;
+
+  //pts of the first and the last frame with motion, valid if triggered
+  bool triggered;
+  int64_t firstMotionPts;
+  int64_t lastMotionPts;
+  //pts of the previous frame, to notice the source restarting
+  bool hasLastPts;
+  int64_t lastPts;
+
+  //conversion buffers of write()
+  cv::Mat colorImage;
+  cv::Mat colorImageSmall;
+};
+
+
+#endif
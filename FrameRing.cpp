@@ -0,0 +1,185 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "FrameRing.h"
+
+#include <cassert>
+#include <chrono>
+
+FrameRing::FrameRing(unsigned int capacity, const cv::Size& size, int type, OverflowPolicy policy_)
+  : ringCapacity(capacity),
+  policy(policy_),
+  slots(capacity + 3),
+  ring(capacity),
+  ringHead(0),
+  ringTail(0),
+  freeList(capacity + 3),
+  freeHead(0),
+  freeTail(0),
+  writeSlot(0),
+  readSlot(NO_SLOT),
+  committed(0),
+  droppedOldest(0),
+  droppedNewest(0)
+{
+  assert(capacity >= 1);
+
+  for (size_t i = 0; i < slots.size(); ++i)
+  {
+    slots[i].image.create(size, type);
+    slots[i].frameSize = size;
+    slots[i].pts = 0;
+    slots[i].captureTimeUs = 0;
+  }
+
+  // slot 0 starts out owned by the producer, all others are free
+  for (uint32_t i = 1; i < slots.size(); ++i)
+  {
+    freeList[freeTail.load(std::memory_order_relaxed)].store(i, std::memory_order_relaxed);
+    freeTail.store(freeTail.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+}
+
+
+uint8_t* FrameRing::beginWrite(size_t bytes)
+{
+  if (writeSlot == NO_SLOT)
+  {
+    const uint32_t head = freeHead.load(std::memory_order_relaxed);
+    // there are capacity + 3 slots, so with the producer holding none at
+    // least one of them is neither queued nor borrowed by the consumer
+    assert(head != freeTail.load(std::memory_order_acquire));
+    writeSlot = freeList[head % freeList.size()].load(std::memory_order_relaxed);
+    freeHead.store(head + 1, std::memory_order_release);
+  }
+
+  cv::Mat& image = slots[writeSlot].image;
+  if (image.total() * image.elemSize() < bytes)
+  {
+    // only happens if the decoder delivers more than announced, keep the
+    // row layout and add rows until the frame fits
+    const size_t rowBytes = image.cols * image.elemSize();
+    image.create((int)((bytes + rowBytes - 1) / rowBytes), image.cols, image.type());
+  }
+
+  return image.data;
+}
+
+
+void FrameRing::commitWrite(const cv::Size& frameSize, int64_t pts)
+{
+  assert(writeSlot != NO_SLOT);
+  slots[writeSlot].frameSize = frameSize;
+  slots[writeSlot].pts = pts;
+  slots[writeSlot].captureTimeUs = nowUs();
+
+  const uint32_t tail = ringTail.load(std::memory_order_relaxed);
+  uint32_t evicted = NO_SLOT;
+
+  if (tail - ringHead.load(std::memory_order_acquire) >= ringCapacity)
+  {
+    if (policy == DropNewest)
+    {
+      // keep the buffer, it gets overwritten by the next frame
+      droppedNewest.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    // if this fails the consumer just made room for us
+    if (tryPop(evicted))
+    {
+      droppedOldest.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  ring[tail % ringCapacity].store(writeSlot, std::memory_order_relaxed);
+  ringTail.store(tail + 1, std::memory_order_release);
+  committed.fetch_add(1, std::memory_order_relaxed);
+
+  // an evicted buffer is reused directly for the next frame
+  writeSlot = evicted;
+}
+
+
+const FrameRing::Slot* FrameRing::acquireRead()
+{
+  uint32_t slotIndex;
+  if (!tryPop(slotIndex))
+  {
+    return NULL;
+  }
+
+  releaseRead();
+  readSlot = slotIndex;
+  return &slots[readSlot];
+}
+
+
+void FrameRing::releaseRead()
+{
+  if (readSlot == NO_SLOT)
+  {
+    return;
+  }
+
+  const uint32_t tail = freeTail.load(std::memory_order_relaxed);
+  freeList[tail % freeList.size()].store(readSlot, std::memory_order_relaxed);
+  freeTail.store(tail + 1, std::memory_order_release);
+  readSlot = NO_SLOT;
+}
+
+
+unsigned int FrameRing::size() const
+{
+  const uint32_t head = ringHead.load(std::memory_order_acquire);
+  const uint32_t tail = ringTail.load(std::memory_order_acquire);
+  return tail - head;
+}
+
+
+int64_t FrameRing::nowUs()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+bool FrameRing::tryPop(uint32_t& slotIndex)
+{
+  // both the consumer and the producer (when evicting) pop, so the head is
+  // advanced with a compare and swap. A stale slot index read here is
+  // harmless because the swap fails if the head moved in between.
+  uint32_t head = ringHead.load(std::memory_order_acquire);
+  for (;;)
+  {
+    if (head == ringTail.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+
+    const uint32_t candidate = ring[head % ringCapacity].load(std::memory_order_relaxed);
+    if (ringHead.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+      slotIndex = candidate;
+      return true;
+    }
+  }
+}
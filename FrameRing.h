@@ -0,0 +1,150 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef FRAME_RING_H_INCLUDED
+#define FRAME_RING_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+   Fixed capacity single-producer/single-consumer ring of preallocated frame
+   buffers.
+
+   The producer (the capture thread) fills a buffer obtained by beginWrite()
+   and publishes it with commitWrite(). The consumer (the detection thread)
+   borrows the oldest published buffer with acquireRead() and hands it back
+   with releaseRead(). No heap allocation and no lock happens on either side
+   once the ring is constructed.
+
+   Internally there are capacity + 3 buffers: up to capacity published ones,
+   one owned by the producer and up to two borrowed by the consumer while it
+   moves on to a newer frame. Buffer ownership moves around as indices
+   through two lock-free index queues.
+ */
+class FrameRing
+{
+public:
+
+  /** What happens to a committed frame when the ring is already full. */
+  enum OverflowPolicy
+  {
+    DropOldest,   ///< evict the oldest queued frame, keep the new one
+    DropNewest    ///< discard the frame that was just written
+  };
+
+  struct Slot
+  {
+    cv::Mat image;
+    cv::Size frameSize;   ///< picture size as reported by the producer
+    int64_t pts;          ///< presentation timestamp in microseconds
+    int64_t captureTimeUs; ///< nowUs() when the frame was committed
+  };
+
+  FrameRing(unsigned int capacity, const cv::Size& size, int type, OverflowPolicy policy);
+
+  /** Producer: returns a buffer of at least bytes size to write the next frame to. */
+  uint8_t* beginWrite(size_t bytes);
+  /** Producer: publishes the buffer returned by the last beginWrite(). */
+  void commitWrite(const cv::Size& frameSize, int64_t pts);
+
+  /**
+     Consumer: borrows the oldest frame, or returns NULL if the ring is empty.
+     A frame borrowed before is handed back only if a new one was found, so
+     calling this in a loop skips to the newest frame.
+   */
+  const Slot* acquireRead();
+  /** Consumer: returns the frame borrowed by acquireRead() to the producer. */
+  void releaseRead();
+
+  unsigned int capacity() const
+  {
+    return ringCapacity;
+  }
+
+
+  /** Number of published frames, may be stale by the time it returns. */
+  unsigned int size() const;
+
+  /** Monotonic clock used for Slot::captureTimeUs. */
+  static int64_t nowUs();
+
+  OverflowPolicy overflowPolicy() const
+  {
+    return policy;
+  }
+
+
+  uint64_t committedCount() const
+  {
+    return committed.load(std::memory_order_relaxed);
+  }
+
+
+  uint64_t droppedOldestCount() const
+  {
+    return droppedOldest.load(std::memory_order_relaxed);
+  }
+
+
+  uint64_t droppedNewestCount() const
+  {
+    return droppedNewest.load(std::memory_order_relaxed);
+  }
+
+
+private:
+
+  FrameRing(const FrameRing&);
+  FrameRing& operator=(const FrameRing&);
+
+  static const uint32_t NO_SLOT = 0xffffffffu;
+
+  bool tryPop(uint32_t& slotIndex);
+
+  const unsigned int ringCapacity;
+  const OverflowPolicy policy;
+
+  std::vector<Slot> slots;
+
+  // published frames, popped by the consumer and (for DropOldest) the producer
+  std::vector<std::atomic<uint32_t> > ring;
+  std::atomic<uint32_t> ringHead;
+  std::atomic<uint32_t> ringTail;
+
+  // buffers handed back by the consumer, pushed by consumer, popped by producer
+  std::vector<std::atomic<uint32_t> > freeList;
+  std::atomic<uint32_t> freeHead;
+  std::atomic<uint32_t> freeTail;
+
+  uint32_t writeSlot;   // owned by the producer
+  uint32_t readSlot;    // owned by the consumer
+
+  std::atomic<uint64_t> committed;
+  std::atomic<uint64_t> droppedOldest;
+  std::atomic<uint64_t> droppedNewest;
+};
+
+
+#endif
@@ -0,0 +1,196 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "FrameSource.h"
+
+#include <algorithm>
+
+#include "LibavCapture.h"
+#include "RawFileCapture.h"
+#include "SyntheticCapture.h"
+#include "VlcCapture.h"
+
+FrameSource::FrameSource(const std::string& url_, const cv::Size& size_, const MotionSettings& settings_,
+                         const std::shared_ptr<FrameRing>& ring, const FrameCallback& frameCallback_)
+  : url(url_),
+  size(size_),
+  settings(settings_),
+  frameRing(ring),
+  frameCallback(frameCallback_)
+{ }
+
+
+FrameSource::~FrameSource()
+{ }
+
+
+std::shared_ptr<FrameSource> FrameSource::create(const std::string& url, const cv::Size& size,
+                                                 const MotionSettings& settings,
+                                                 const std::shared_ptr<FrameRing>& ring,
+                                                 const FrameCallback& frameCallback)
+{
+  if (url.compare(0, 10, "synthetic:") == 0)
+  {
+    return std::make_shared<SyntheticCapture>(url, size, settings, ring, frameCallback);
+  }
+  if (url.compare(0, 4, "raw:") == 0)
+  {
+    return std::make_shared<RawFileCapture>(url.substr(4), size, settings, ring, frameCallback);
+  }
+  if (settings.captureEngine == MotionSettings::EngineLibav)
+  {
+    return std::make_shared<LibavCapture>(url, size, settings, ring, frameCallback);
+  }
+  return std::make_shared<VlcCapture>(url, size, settings, ring, frameCallback);
+}
+
+
+bool FrameSource::setPacketRecorder(const std::shared_ptr<PacketRecorder>&)
+{
+  return false;
+}
+
+
+void FrameSource::setEndCallback(const EndCallback& callback)
+{
+  endCallback = callback;
+}
+
+
+size_t FrameSource::frameBytes(const cv::Size& size, MotionSettings::CaptureFormat format)
+{
+  const size_t pixels = (size_t)size.width * size.height;
+  return format == MotionSettings::CaptureLuma ? pixels * 3 / 2 : pixels * 3;
+}
+
+
+void FrameSource::deliver(const cv::Size& frameSize, int64_t pts)
+{
+  frameRing->commitWrite(frameSize, pts);
+  frameCallback();
+}
+
+
+void FrameSource::notifyEnd()
+{
+  if (endCallback)
+  {
+    endCallback();
+  }
+}
+
+
+ThreadedFrameSource::ThreadedFrameSource(const std::string& url, const cv::Size& size,
+                                         const MotionSettings& settings,
+                                         const std::shared_ptr<FrameRing>& ring,
+                                         const FrameCallback& frameCallback)
+  : FrameSource(url, size, settings, ring, frameCallback),
+  stopRequested(false),
+  running(false),
+  hasFirstPts(false),
+  firstPts(0)
+{ }
+
+
+ThreadedFrameSource::~ThreadedFrameSource()
+{
+  // derived classes have to call stop() in their destructor, run() is gone here
+}
+
+
+bool ThreadedFrameSource::start()
+{
+  stop();
+
+  stopRequested = false;
+  hasFirstPts = false;
+  running = true;
+  thread = std::thread(&ThreadedFrameSource::runThread, this);
+  return true;
+}
+
+
+void ThreadedFrameSource::stop()
+{
+  stopRequested = true;
+  if (thread.joinable())
+  {
+    thread.join();
+  }
+  running = false;
+}
+
+
+bool ThreadedFrameSource::isRunning() const
+{
+  return running.load();
+}
+
+
+void ThreadedFrameSource::runThread()
+{
+  run();
+  running = false;
+  // the input ran out by itself, after stop() nobody wants it restarted
+  if (!stopRequested)
+  {
+    notifyEnd();
+  }
+}
+
+
+bool ThreadedFrameSource::pace(int64_t pts)
+{
+  if (settings.pacing == MotionSettings::PaceFast)
+  {
+    // back pressure instead of dropping, every frame reaches the detector
+    while (frameRing->size() >= frameRing->capacity())
+    {
+      if (stopRequested)
+      {
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return !stopRequested;
+  }
+
+  if (!hasFirstPts)
+  {
+    hasFirstPts = true;
+    firstPts = pts;
+    firstFrameTime = std::chrono::steady_clock::now();
+    return !stopRequested;
+  }
+
+  const std::chrono::steady_clock::time_point due = firstFrameTime + std::chrono::microseconds(pts - firstPts);
+  // sleep in small steps so stop() does not have to wait for a long gap in the stream
+  while (std::chrono::steady_clock::now() < due)
+  {
+    if (stopRequested)
+    {
+      return false;
+    }
+    const std::chrono::steady_clock::duration left = due - std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(left, std::chrono::milliseconds(50)));
+  }
+  return !stopRequested;
+}
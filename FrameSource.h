@@ -0,0 +1,156 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef FRAME_SOURCE_H_INCLUDED
+#define FRAME_SOURCE_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "FrameRing.h"
+#include "MotionSettings.h"
+
+class PacketRecorder;
+
+/**
+   Producer of decoded frames for QtMotionTracking.
+
+   A frame source writes pictures of the configured size and capture format
+   into the FrameRing and calls the frame callback after each one, and the
+   end callback when the input may have ended. The consumer never talks to
+   the capture library, so engines and test inputs can be swapped without
+   touching the detection code.
+ */
+class FrameSource
+{
+public:
+
+  typedef std::function<void()> FrameCallback;
+  typedef std::function<void()> EndCallback;
+
+  FrameSource(const std::string& url, const cv::Size& size, const MotionSettings& settings,
+              const std::shared_ptr<FrameRing>& ring, const FrameCallback& frameCallback);
+  virtual ~FrameSource();
+
+  /**
+     Picks the implementation for url:
+     - "synthetic:" generated test pictures, see SyntheticCapture
+     - "raw:<file>" raw frame dump, see RawFileCapture
+     - everything else goes to the engine selected in the settings
+   */
+  static std::shared_ptr<FrameSource> create(const std::string& url, const cv::Size& size,
+                                             const MotionSettings& settings,
+                                             const std::shared_ptr<FrameRing>& ring,
+                                             const FrameCallback& frameCallback);
+
+  /** Starts delivering frames. Called again by reopenTimer whenever isRunning() is false. */
+  virtual bool start() = 0;
+  virtual void stop() = 0;
+  virtual bool isRunning() const = 0;
+
+  /**
+     Hands the compressed packets of the stream to recorder as well.
+     Returns false if the engine only has decoded pictures.
+   */
+  virtual bool setPacketRecorder(const std::shared_ptr<PacketRecorder>& recorder);
+
+  /**
+     Called from the capture thread when the input ended or the player
+     changed its state, so the consumer can restart it without waiting for
+     its reopen timer. Has to be set before start().
+   */
+  void setEndCallback(const EndCallback& callback);
+
+  /** Bytes of one frame in the ring for the given size and capture format. */
+  static size_t frameBytes(const cv::Size& size, MotionSettings::CaptureFormat format);
+
+protected:
+
+  /** Publishes the frame written to the ring and notifies the consumer. */
+  void deliver(const cv::Size& frameSize, int64_t pts);
+
+  /** Tells the consumer that isRunning() may have turned false. */
+  void notifyEnd();
+
+  const std::string url;
+  const cv::Size size;
+  const MotionSettings settings;
+  const std::shared_ptr<FrameRing> frameRing;
+  const FrameCallback frameCallback;
+
+private:
+
+  EndCallback endCallback;
+
+  FrameSource(const FrameSource&);
+  FrameSource& operator=(const FrameSource&);
+};
+
+
+/**
+   Base for frame sources that produce frames on a thread of their own.
+ */
+class ThreadedFrameSource : public FrameSource
+{
+public:
+
+  ThreadedFrameSource(const std::string& url, const cv::Size& size, const MotionSettings& settings,
+                      const std::shared_ptr<FrameRing>& ring, const FrameCallback& frameCallback);
+  virtual ~ThreadedFrameSource();
+
+  virtual bool start();
+  virtual void stop();
+  virtual bool isRunning() const;
+
+protected:
+
+  /** Produces frames until the input ends or stopRequested is set. */
+  virtual void run() = 0;
+
+  /**
+     Applies MotionSettings::pacing before the frame with pts is written.
+     PaceRealtime sleeps until the frame is due relative to the first one,
+     PaceFast waits for a free ring slot so the ring drops no frame, the
+     DetectionPipeline then processes them all.
+     Returns false if the source is being stopped.
+   */
+  bool pace(int64_t pts);
+
+  std::atomic<bool> stopRequested;
+
+private:
+
+  void runThread();
+
+  std::thread thread;
+  std::atomic<bool> running;
+
+  bool hasFirstPts;
+  int64_t firstPts;
+  std::chrono::steady_clock::time_point firstFrameTime;
+};
+
+
+#endif
@@ -0,0 +1,397 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "FusedMotionKernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FUSED_KERNEL_AVX2 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+
+/** BORDER_REFLECT_101 for an index at most n - 1 outside of [0, n). */
+inline int reflect101(int i, int n)
+{
+  if (i < 0)
+  {
+    return -i;
+  }
+  if (i >= n)
+  {
+    return 2 * n - 2 - i;
+  }
+  return i;
+}
+
+
+/**
+   counts[x] += (|addLast[x] - addCurrent[x]| > sensitivity), and if the
+   remove row is given counts[x] -= (|removeLast[x] - removeCurrent[x]| > sensitivity)
+ */
+typedef void (*UpdateCountsFunction)(const uint8_t* addLast, const uint8_t* addCurrent,
+                                     const uint8_t* removeLast, const uint8_t* removeCurrent,
+                                     uint8_t* counts, int n, int sensitivity);
+
+/** mask[x] = sum of counts[x .. x + taps - 1] >= minCount ? 255 : 0 */
+typedef void (*HorizontalFunction)(const uint8_t* counts, uint8_t* mask, int n, int taps, int minCount);
+
+
+void updateCountsScalar(const uint8_t* addLast, const uint8_t* addCurrent,
+                        const uint8_t* removeLast, const uint8_t* removeCurrent,
+                        uint8_t* counts, int n, int sensitivity)
+{
+  for (int x = 0; x < n; ++x)
+  {
+    counts[x] += std::abs(addLast[x] - addCurrent[x]) > sensitivity;
+  }
+  if (removeLast)
+  {
+    for (int x = 0; x < n; ++x)
+    {
+      counts[x] -= std::abs(removeLast[x] - removeCurrent[x]) > sensitivity;
+    }
+  }
+}
+
+
+void horizontalScalar(const uint8_t* counts, uint8_t* mask, int n, int taps, int minCount)
+{
+  if (n <= 0)
+  {
+    return;
+  }
+  int sum = 0;
+  for (int j = 0; j < taps; ++j)
+  {
+    sum += counts[j];
+  }
+  for (int x = 0; ; ++x)
+  {
+    mask[x] = sum >= minCount ? 255 : 0;
+    if (x + 1 == n)
+    {
+      break;
+    }
+    sum += counts[x + taps] - counts[x];
+  }
+}
+
+
+#if defined(__SSE2__)
+
+// |a - b| > s as 0xff/0x00, s1 is s + 1
+inline __m128i exceedsSse2(__m128i a, __m128i b, __m128i s1)
+{
+  const __m128i diff = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+  return _mm_cmpeq_epi8(_mm_max_epu8(diff, s1), diff);
+}
+
+
+void updateCountsSse2(const uint8_t* addLast, const uint8_t* addCurrent,
+                      const uint8_t* removeLast, const uint8_t* removeCurrent,
+                      uint8_t* counts, int n, int sensitivity)
+{
+  const __m128i s1 = _mm_set1_epi8((char)(sensitivity + 1));
+  int x = 0;
+  for (; x + 16 <= n; x += 16)
+  {
+    __m128i c = _mm_loadu_si128((const __m128i*)(counts + x));
+    // a set mask is -1, subtracting it counts one up
+    c = _mm_sub_epi8(c, exceedsSse2(_mm_loadu_si128((const __m128i*)(addLast + x)),
+                                    _mm_loadu_si128((const __m128i*)(addCurrent + x)), s1));
+    if (removeLast)
+    {
+      c = _mm_add_epi8(c, exceedsSse2(_mm_loadu_si128((const __m128i*)(removeLast + x)),
+                                      _mm_loadu_si128((const __m128i*)(removeCurrent + x)), s1));
+    }
+    _mm_storeu_si128((__m128i*)(counts + x), c);
+  }
+  updateCountsScalar(addLast + x, addCurrent + x, removeLast ? removeLast + x : NULL,
+                     removeLast ? removeCurrent + x : NULL, counts + x, n - x, sensitivity);
+}
+
+
+void horizontalSse2(const uint8_t* counts, uint8_t* mask, int n, int taps, int minCount)
+{
+  const __m128i minimum = _mm_set1_epi8((char)minCount);
+  int x = 0;
+  for (; x + 16 <= n; x += 16)
+  {
+    // at most 15 x 15 set pixels, the sum fits into a byte
+    __m128i sum = _mm_loadu_si128((const __m128i*)(counts + x));
+    for (int j = 1; j < taps; ++j)
+    {
+      sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i*)(counts + x + j)));
+    }
+    _mm_storeu_si128((__m128i*)(mask + x), _mm_cmpeq_epi8(_mm_max_epu8(sum, minimum), sum));
+  }
+  horizontalScalar(counts + x, mask + x, n - x, taps, minCount);
+}
+
+#endif
+
+
+#if defined(FUSED_KERNEL_AVX2)
+
+__attribute__((target("avx2")))
+inline __m256i exceedsAvx2(__m256i a, __m256i b, __m256i s1)
+{
+  const __m256i diff = _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+  return _mm256_cmpeq_epi8(_mm256_max_epu8(diff, s1), diff);
+}
+
+
+__attribute__((target("avx2")))
+void updateCountsAvx2(const uint8_t* addLast, const uint8_t* addCurrent,
+                      const uint8_t* removeLast, const uint8_t* removeCurrent,
+                      uint8_t* counts, int n, int sensitivity)
+{
+  const __m256i s1 = _mm256_set1_epi8((char)(sensitivity + 1));
+  int x = 0;
+  for (; x + 32 <= n; x += 32)
+  {
+    __m256i c = _mm256_loadu_si256((const __m256i*)(counts + x));
+    c = _mm256_sub_epi8(c, exceedsAvx2(_mm256_loadu_si256((const __m256i*)(addLast + x)),
+                                       _mm256_loadu_si256((const __m256i*)(addCurrent + x)), s1));
+    if (removeLast)
+    {
+      c = _mm256_add_epi8(c, exceedsAvx2(_mm256_loadu_si256((const __m256i*)(removeLast + x)),
+                                         _mm256_loadu_si256((const __m256i*)(removeCurrent + x)), s1));
+    }
+    _mm256_storeu_si256((__m256i*)(counts + x), c);
+  }
+  updateCountsScalar(addLast + x, addCurrent + x, removeLast ? removeLast + x : NULL,
+                     removeLast ? removeCurrent + x : NULL, counts + x, n - x, sensitivity);
+}
+
+
+__attribute__((target("avx2")))
+void horizontalAvx2(const uint8_t* counts, uint8_t* mask, int n, int taps, int minCount)
+{
+  const __m256i minimum = _mm256_set1_epi8((char)minCount);
+  int x = 0;
+  for (; x + 32 <= n; x += 32)
+  {
+    __m256i sum = _mm256_loadu_si256((const __m256i*)(counts + x));
+    for (int j = 1; j < taps; ++j)
+    {
+      sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)(counts + x + j)));
+    }
+    _mm256_storeu_si256((__m256i*)(mask + x), _mm256_cmpeq_epi8(_mm256_max_epu8(sum, minimum), sum));
+  }
+  horizontalScalar(counts + x, mask + x, n - x, taps, minCount);
+}
+
+#endif
+
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+void updateCountsNeon(const uint8_t* addLast, const uint8_t* addCurrent,
+                      const uint8_t* removeLast, const uint8_t* removeCurrent,
+                      uint8_t* counts, int n, int sensitivity)
+{
+  const uint8x16_t s = vdupq_n_u8((uint8_t)sensitivity);
+  int x = 0;
+  for (; x + 16 <= n; x += 16)
+  {
+    uint8x16_t c = vld1q_u8(counts + x);
+    c = vsubq_u8(c, vcgtq_u8(vabdq_u8(vld1q_u8(addLast + x), vld1q_u8(addCurrent + x)), s));
+    if (removeLast)
+    {
+      c = vaddq_u8(c, vcgtq_u8(vabdq_u8(vld1q_u8(removeLast + x), vld1q_u8(removeCurrent + x)), s));
+    }
+    vst1q_u8(counts + x, c);
+  }
+  updateCountsScalar(addLast + x, addCurrent + x, removeLast ? removeLast + x : NULL,
+                     removeLast ? removeCurrent + x : NULL, counts + x, n - x, sensitivity);
+}
+
+
+void horizontalNeon(const uint8_t* counts, uint8_t* mask, int n, int taps, int minCount)
+{
+  const uint8x16_t minimum = vdupq_n_u8((uint8_t)minCount);
+  int x = 0;
+  for (; x + 16 <= n; x += 16)
+  {
+    uint8x16_t sum = vld1q_u8(counts + x);
+    for (int j = 1; j < taps; ++j)
+    {
+      sum = vaddq_u8(sum, vld1q_u8(counts + x + j));
+    }
+    vst1q_u8(mask + x, vcgeq_u8(sum, minimum));
+  }
+  horizontalScalar(counts + x, mask + x, n - x, taps, minCount);
+}
+
+#endif
+
+
+struct Implementation
+{
+  const char* name;
+  UpdateCountsFunction updateCounts;
+  HorizontalFunction horizontal;
+};
+
+
+Implementation chooseImplementation()
+{
+#if defined(FUSED_KERNEL_AVX2)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    const Implementation avx2 = { "avx2", &updateCountsAvx2, &horizontalAvx2 };
+    return avx2;
+  }
+#endif
+#if defined(__SSE2__)
+  const Implementation sse2 = { "sse2", &updateCountsSse2, &horizontalSse2 };
+  return sse2;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  const Implementation neon = { "neon", &updateCountsNeon, &horizontalNeon };
+  return neon;
+#else
+  const Implementation scalar = { "scalar", &updateCountsScalar, &horizontalScalar };
+  return scalar;
+#endif
+}
+
+
+const Implementation& implementation()
+{
+  static const Implementation chosen = chooseImplementation();
+  return chosen;
+}
+
+}
+
+
+FusedMotionKernel::FusedMotionKernel(int sensitivity_, int blurSize_)
+  : sensitivity(sensitivity_),
+  blurSize(blurSize_),
+  anchor(blurSize_ / 2),
+  minCount(0)
+{
+  // cv::blur rounds 255 * k / (B * B) to the nearest integer, find the
+  // first k that ends up above the threshold
+  const int area = blurSize * blurSize;
+  minCount = area + 1;
+  for (int k = 0; k <= area; ++k)
+  {
+    if (cvRound(255.0 * k / area) > sensitivity)
+    {
+      minCount = k;
+      break;
+    }
+  }
+  // never reached, a byte sum of at most 225 stays below 255
+  minCount = std::min(minCount, 255);
+}
+
+
+bool FusedMotionKernel::supports(const cv::Size& size) const
+{
+  // the counts are bytes, reflection needs the box to fit into the image
+  return blurSize >= 1 && blurSize * blurSize <= 225 &&
+         sensitivity >= 0 && sensitivity < 255 &&
+         size.width > blurSize && size.height > blurSize;
+}
+
+
+const char* FusedMotionKernel::instructionSet()
+{
+  return implementation().name;
+}
+
+
+void FusedMotionKernel::apply(const cv::Mat& last, const cv::Mat& current, cv::Mat& mask)
+{
+  mask.create(current.rows, current.cols, CV_8UC1);
+  apply(last.data, last.step, current.data, current.step, current.size(), mask.data, mask.step,
+        cv::Rect(0, 0, current.cols, current.rows));
+}
+
+
+void FusedMotionKernel::apply(const uint8_t* last, size_t lastStep, const uint8_t* current, size_t currentStep,
+                              const cv::Size& size, uint8_t* mask, size_t maskStep, const cv::Rect& rect)
+{
+  const Implementation& simd = implementation();
+  const int after = blurSize - 1 - anchor;
+
+  // columns whose counts the box around rect needs, reflected ones included
+  const int columnBegin = std::max(0, rect.x - blurSize);
+  const int columnEnd = std::min(size.width, rect.x + rect.width + blurSize);
+  const int columns = columnEnd - columnBegin;
+  columnCounts.assign(columns, 0);
+  paddedCounts.resize(rect.width + blurSize - 1);
+
+  uint8_t* counts = &columnCounts[0];
+  for (int row = rect.y; row < rect.y + rect.height; ++row)
+  {
+    if (row == rect.y)
+    {
+      for (int dy = -anchor; dy <= after; ++dy)
+      {
+        const int y = reflect101(row + dy, size.height);
+        simd.updateCounts(last + y * lastStep + columnBegin, current + y * currentStep + columnBegin,
+                          NULL, NULL, counts, columns, sensitivity);
+      }
+    }
+    else
+    {
+      // the row below the box enters, the row above it leaves
+      const int added = reflect101(row + after, size.height);
+      const int removed = reflect101(row - anchor - 1, size.height);
+      simd.updateCounts(last + added * lastStep + columnBegin, current + added * currentStep + columnBegin,
+                        last + removed * lastStep + columnBegin, current + removed * currentStep + columnBegin,
+                        counts, columns, sensitivity);
+    }
+
+    // only the few columns outside of the image need the reflection
+    const int first = rect.x - anchor;
+    const int padded = (int)paddedCounts.size();
+    const int insideBegin = std::max(0, -first);
+    const int insideEnd = std::min(padded, size.width - first);
+    for (int i = 0; i < insideBegin; ++i)
+    {
+      paddedCounts[i] = counts[reflect101(first + i, size.width) - columnBegin];
+    }
+    std::copy(counts + first + insideBegin - columnBegin, counts + first + insideEnd - columnBegin,
+              paddedCounts.begin() + insideBegin);
+    for (int i = insideEnd; i < padded; ++i)
+    {
+      paddedCounts[i] = counts[reflect101(first + i, size.width) - columnBegin];
+    }
+    simd.horizontal(&paddedCounts[0], mask + row * maskStep + rect.x, rect.width, blurSize, minCount);
+  }
+}
@@ -0,0 +1,89 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef FUSED_MOTION_KERNEL_H_INCLUDED
+#define FUSED_MOTION_KERNEL_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+   The motion mask of MotionDetector in a single streaming pass:
+
+   threshold(blur(threshold(absdiff(last, current), S), B x B), S)
+
+   A pixel of the first threshold image is either 0 or 255, so the blurred
+   value is round(255 * k / (B * B)) for k set pixels under the box, and the
+   second threshold only asks whether k reaches the smallest count that
+   rounds above S. The kernel keeps the number of set pixels per column of
+   the box, updates it with one row entering and one row leaving, and
+   compares the horizontal sum of B column counts against that minimum.
+   Borders are handled like cv::blur's default BORDER_REFLECT_101, so the
+   result is bit exact to the OpenCV chain.
+
+   The inner loops use SSE2 or AVX2 on x86, chosen at runtime, NEON on ARM
+   if the compiler targets it, and plain C++ otherwise.
+
+   An instance owns its row buffers and must only be used by one thread at
+   a time.
+ */
+class FusedMotionKernel
+{
+public:
+
+  FusedMotionKernel(int sensitivity, int blurSize);
+
+  /** False if the image is too small for the box or the parameters are out of range. */
+  bool supports(const cv::Size& size) const;
+
+  /** Computes the whole mask, mask is (re)allocated as CV_8UC1 of the same size. */
+  void apply(const cv::Mat& last, const cv::Mat& current, cv::Mat& mask);
+
+  /**
+     Computes the mask pixels inside rect only, reading the input around it
+     as far as the box reaches. last, current and mask are 8 bit images of
+     the given size with their own row strides.
+   */
+  void apply(const uint8_t* last, size_t lastStep, const uint8_t* current, size_t currentStep,
+             const cv::Size& size, uint8_t* mask, size_t maskStep, const cv::Rect& rect);
+
+  /** Name of the code path chosen for this CPU, e.g. "avx2". */
+  static const char* instructionSet();
+
+private:
+
+  const int sensitivity;
+  const int blurSize;
+  //offset of the box's first row and column relative to the pixel, like cv::blur's default anchor
+  const int anchor;
+  //smallest number of set pixels in the box that survives the second threshold
+  int minCount;
+
+  //set pixels per column of the box for the current row
+  std::vector<uint8_t> columnCounts;
+  //columnCounts of the row extended by the reflected border
+  std::vector<uint8_t> paddedCounts;
+};
+
+
+#endif
@@ -0,0 +1,445 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "KernelBenchmark.h"
+
+#include <opencv/cv.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "BackgroundModel.h"
+#include "BandPool.h"
+#include "CoarseMotion.h"
+#include "FusedMotionKernel.h"
+#include "MotionDetector.h"
+
+using namespace cv;
+
+namespace
+{
+
+uint32_t xorshift(uint32_t& state)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+
+/** Gradient with sensor noise and a bright block at offset, like SyntheticCapture. */
+void generateFrame(cv::Mat& frame, const cv::Size& size, int offset, uint32_t& state, int noise)
+{
+  frame.create(size.height, size.width, CV_8UC1);
+  for (int y = 0; y < size.height; ++y)
+  {
+    uint8_t* row = frame.ptr(y);
+    for (int x = 0; x < size.width; ++x)
+    {
+      const int value = (x + y) * 160 / (size.width + size.height) + 40 + (int)(xorshift(state) % (2 * noise + 1)) - noise;
+      row[x] = (uint8_t)std::max(0, std::min(255, value));
+    }
+  }
+
+  const int block = size.height / 5;
+  const int x0 = (offset * 7) % (size.width - block);
+  const int y0 = (offset * 3) % (size.height - block);
+  for (int y = y0; y < y0 + block; ++y)
+  {
+    uint8_t* row = frame.ptr(y);
+    for (int x = x0; x < x0 + block; ++x)
+    {
+      row[x] = 230;
+    }
+  }
+}
+
+
+/**
+   Time of comparing a frame with the background, model update included,
+   against comparing it with the previous frame by cv::absdiff. Both feed
+   the same mask kernel afterwards, which is left out.
+ */
+void benchmarkBackgroundModel(const cv::Size* sizes, size_t count)
+{
+  const int FRAMES = 8;
+  for (size_t s = 0; s < count; ++s)
+  {
+    const cv::Size& size = sizes[s];
+    uint32_t state = 88675123u;
+    std::vector<cv::Mat> frames(FRAMES);
+    for (int i = 0; i < FRAMES; ++i)
+    {
+      generateFrame(frames[i], size, i * 11, state, 6);
+    }
+
+    BackgroundModel model(0.02);
+    cv::Mat background;
+    cv::Mat difference;
+    model.apply(frames[0], background);
+
+    const int rounds = std::max(4, (int)(100000000LL / size.area()));
+    double absdiffMs = 0;
+    double backgroundMs = 0;
+    for (int round = 0; round < rounds; ++round)
+    {
+      const cv::Mat& last = frames[round % FRAMES];
+      const cv::Mat& current = frames[(round + 1) % FRAMES];
+
+      const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+      cv::absdiff(last, current, difference);
+      const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+      model.apply(current, background);
+      cv::absdiff(background, current, difference);
+      const std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+      absdiffMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+      backgroundMs += std::chrono::duration<double, std::milli>(t2 - t1).count();
+    }
+
+    printf("%4dx%-4d absdiff %7.3lfms  background model %7.3lfms  ratio %5.2lfx\n",
+           size.width, size.height, absdiffMs / rounds, backgroundMs / rounds, backgroundMs / absdiffMs);
+  }
+}
+
+
+uint64_t countDifferences(const cv::Mat& a, const cv::Mat& b);
+
+
+/**
+   Time of the per pixel detection work, background update, motion mask and
+   mask moments, on 1 to N threads of a BandPool. Returns the number of mask
+   pixels that differ from the single threaded result.
+ */
+uint64_t benchmarkBands(const cv::Size* sizes, size_t count)
+{
+  const int FRAMES = 8;
+  const unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  uint64_t totalDifferences = 0;
+  for (size_t s = 0; s < count; ++s)
+  {
+    const cv::Size& size = sizes[s];
+    uint32_t state = 521288629u;
+    std::vector<cv::Mat> frames(FRAMES);
+    for (int i = 0; i < FRAMES; ++i)
+    {
+      generateFrame(frames[i], size, i * 11, state, i % 4 == 3 ? 60 : 6);
+    }
+
+    cv::Mat singleMask;
+    double singleMs = 0;
+    for (unsigned int threads = 1; threads <= maxThreads; ++threads)
+    {
+      BandPool pool(threads);
+      MotionDetector detector(0, &pool);
+      BackgroundModel model(0.02, &pool);
+      cv::Mat background;
+      cv::Mat mask;
+      std::vector<Blob> blobs;
+      const cv::Rect image(0, 0, size.width, size.height);
+      model.apply(frames[0], background);
+
+      const int rounds = std::max(4, (int)(20000000LL / size.area()));
+      uint64_t differences = 0;
+      double ms = 0;
+      for (int round = 0; round < rounds; ++round)
+      {
+        const cv::Mat& current = frames[(round + 1) % FRAMES];
+
+        const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        model.apply(current, background);
+        detector.computeThreshold(background, current, mask);
+        detector.measureMovement(mask, image, blobs);
+        const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+        // every thread count sees the same frames, the first round compares the masks
+        if (round == 0 && threads == 1)
+        {
+          mask.copyTo(singleMask);
+        }
+        else if (round == 0)
+        {
+          differences += countDifferences(singleMask, mask);
+        }
+      }
+
+      ms /= rounds;
+      if (threads == 1)
+      {
+        singleMs = ms;
+      }
+      printf("%4dx%-4d %u threads %7.3lfms  speedup %5.2lfx  differing pixels %llu\n",
+             size.width, size.height, threads, ms, singleMs / ms, (unsigned long long)differences);
+      totalDifferences += differences;
+    }
+  }
+  return totalDifferences;
+}
+
+
+/** Picks [from, to) inside [begin, end), about half of the spans touch one of its ends. */
+void randomSpan(uint32_t& state, int begin, int end, int& from, int& to)
+{
+  // spill over both ends and clamp
+  const int length = end - begin;
+  const int a = begin - length / 4 + (int)(xorshift(state) % (length + length / 2));
+  const int b = begin - length / 4 + (int)(xorshift(state) % (length + length / 2));
+  from = std::max(begin, std::min(a, b));
+  to = std::min(end, std::max(a, b) + 1);
+  if (from >= to)
+  {
+    from = std::min(from, end - 1);
+    to = from + 1;
+  }
+}
+
+
+/**
+   Compares the mask computed inside regions of the image, as the coarse
+   check and the tracker's search rects ask for it, with the OpenCV chain
+   on the whole image. Each round has one random rect in the left and one
+   in the right half, many of them touch the image border. Returns the
+   number of mask pixels that differ, outside of the rects the mask has to
+   stay 0.
+ */
+uint64_t checkRegions(const cv::Size* sizes, size_t count)
+{
+  const int ROUNDS = 200;
+  const unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+  uint64_t totalDifferences = 0;
+  for (size_t s = 0; s < count; ++s)
+  {
+    const cv::Size& size = sizes[s];
+    uint32_t state = 3141592653u;
+    cv::Mat last;
+    cv::Mat current;
+    // noise around the sensitivity, the mask has edges everywhere
+    generateFrame(last, size, 0, state, 30);
+    generateFrame(current, size, 11, state, 30);
+
+    MotionDetector reference;
+    cv::Mat referenceMask;
+    reference.computeThresholdReference(last, current, referenceMask);
+
+    BandPool pool(threads);
+    MotionDetector detector(0, &pool);
+    std::vector<cv::Rect> regions(2);
+    cv::Mat mask;
+    cv::Mat expected(size, CV_8UC1);
+    uint64_t differences = 0;
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+      for (int half = 0; half < 2; ++half)
+      {
+        int x0, x1, y0, y1;
+        randomSpan(state, half * size.width / 2, (half + 1) * size.width / 2, x0, x1);
+        randomSpan(state, 0, size.height, y0, y1);
+        regions[half] = cv::Rect(x0, y0, x1 - x0, y1 - y0);
+      }
+      detector.computeThreshold(last, current, regions, mask);
+
+      expected.setTo(cv::Scalar(0));
+      for (size_t i = 0; i < regions.size(); ++i)
+      {
+        cv::Mat region = expected(regions[i]);
+        referenceMask(regions[i]).copyTo(region);
+      }
+      differences += countDifferences(expected, mask);
+    }
+
+    printf("%4dx%-4d %d region pairs on %u threads, differing pixels %llu\n",
+           size.width, size.height, ROUNDS, threads, (unsigned long long)differences);
+    totalDifferences += differences;
+  }
+  return totalDifferences;
+}
+
+
+/**
+   Compares the mask computed only in the regions CoarseMotion flags with the
+   full mask, on frame pairs that differ by a single small block of lower
+   and lower contrast. Prints the mask pixels and the changes the coarse
+   check loses, which is why it is off by default, and returns the number
+   of mask pixels it found that the full mask does not have, which has to
+   be 0.
+ */
+uint64_t checkCoarse(const cv::Size* sizes, size_t count)
+{
+  const int ROUNDS = 100;
+  const int sides[] = { 2, 4, 8, 16 };
+  const int contrasts[] = { 120, 60, 45 };
+  uint64_t totalAdded = 0;
+  for (size_t s = 0; s < count; ++s)
+  {
+    const cv::Size& size = sizes[s];
+    const cv::Size coarseSize = CoarseMotion::coarseSize(size);
+    MotionDetector detector;
+    CoarseMotion coarse(size, MotionDetector::BLUR_SIZE);
+    cv::Mat last;
+    cv::Mat current;
+    cv::Mat lastCoarse;
+    cv::Mat currentCoarse;
+    cv::Mat fullMask;
+    cv::Mat coarseMask;
+    uint32_t frameState = 362436069u;
+    generateFrame(last, size, 0, frameState, 6);
+    cv::resize(last, lastCoarse, coarseSize, 0, 0, cv::INTER_AREA);
+
+    for (size_t c = 0; c < sizeof(contrasts) / sizeof(contrasts[0]); ++c)
+    {
+      for (size_t b = 0; b < sizeof(sides) / sizeof(sides[0]); ++b)
+      {
+        const int side = sides[b];
+        uint32_t state = 1442695040u;
+        uint64_t fullPixels = 0;
+        uint64_t lostPixels = 0;
+        int changes = 0;
+        int lostChanges = 0;
+        for (int round = 0; round < ROUNDS; ++round)
+        {
+          last.copyTo(current);
+          const int x0 = xorshift(state) % (size.width - side);
+          const int y0 = xorshift(state) % (size.height - side);
+          for (int y = y0; y < y0 + side; ++y)
+          {
+            uint8_t* row = current.ptr(y);
+            for (int x = x0; x < x0 + side; ++x)
+            {
+              row[x] = (uint8_t)(row[x] < 128 ? row[x] + contrasts[c] : row[x] - contrasts[c]);
+            }
+          }
+
+          detector.computeThreshold(last, current, fullMask);
+          cv::resize(current, currentCoarse, coarseSize, 0, 0, cv::INTER_AREA);
+          coarse.compare(lastCoarse, currentCoarse);
+          detector.computeThreshold(last, current, coarse.regions(), coarseMask);
+
+          const uint64_t full = cv::countNonZero(fullMask);
+          const uint64_t found = cv::countNonZero(coarseMask);
+          const uint64_t differences = countDifferences(fullMask, coarseMask);
+          // the regions only leave pixels out, every pixel they add is an error
+          const uint64_t added = (differences - (full - found)) / 2;
+          fullPixels += full;
+          lostPixels += full - found + added;
+          totalAdded += added;
+          if (full > 0)
+          {
+            changes += 1;
+            lostChanges += found == 0;
+          }
+        }
+
+        printf("%4dx%-4d coarse check, %2dx%-2d block of contrast %3d: lost %llu of %llu mask pixels, "
+               "%d of %d changes\n", size.width, size.height, side, side, contrasts[c],
+               (unsigned long long)lostPixels, (unsigned long long)fullPixels, lostChanges, changes);
+      }
+    }
+  }
+  return totalAdded;
+}
+
+
+uint64_t countDifferences(const cv::Mat& a, const cv::Mat& b)
+{
+  uint64_t differences = 0;
+  for (int y = 0; y < a.rows; ++y)
+  {
+    const uint8_t* rowA = a.ptr(y);
+    const uint8_t* rowB = b.ptr(y);
+    for (int x = 0; x < a.cols; ++x)
+    {
+      differences += rowA[x] != rowB[x];
+    }
+  }
+  return differences;
+}
+
+}
+
+
+int runKernelBenchmark()
+{
+  const cv::Size sizes[] = { cv::Size(320, 240), cv::Size(640, 480), cv::Size(1280, 720), cv::Size(1920, 1080) };
+  //frames per resolution, the pairs are reused round robin
+  const int FRAMES = 8;
+
+  printf("fused kernel: %s, sensitivity %d, blur %d\n", FusedMotionKernel::instructionSet(),
+         MotionDetector::SENSITIVITY_VALUE, MotionDetector::BLUR_SIZE);
+
+  uint64_t totalDifferences = 0;
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+  {
+    const cv::Size& size = sizes[s];
+    uint32_t state = 2463534242u;
+    std::vector<cv::Mat> frames(FRAMES);
+    for (int i = 0; i < FRAMES; ++i)
+    {
+      // alternate quiet and very noisy frames, the noisy ones hit the threshold everywhere
+      generateFrame(frames[i], size, i * 11, state, i % 4 == 3 ? 60 : 6);
+    }
+
+    MotionDetector detector;
+    FusedMotionKernel kernel(MotionDetector::SENSITIVITY_VALUE, MotionDetector::BLUR_SIZE);
+    cv::Mat referenceMask;
+    cv::Mat fusedMask;
+
+    // enough rounds for about a quarter of a second of the slower path on a PC
+    const int rounds = std::max(4, (int)(20000000LL / size.area()));
+    uint64_t differences = 0;
+    double referenceMs = 0;
+    double fusedMs = 0;
+    for (int round = 0; round < rounds; ++round)
+    {
+      const cv::Mat& last = frames[round % FRAMES];
+      const cv::Mat& current = frames[(round + 1) % FRAMES];
+
+      const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+      detector.computeThresholdReference(last, current, referenceMask);
+      const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+      kernel.apply(last, current, fusedMask);
+      const std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+      referenceMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+      fusedMs += std::chrono::duration<double, std::milli>(t2 - t1).count();
+      if (round < FRAMES)
+      {
+        differences += countDifferences(referenceMask, fusedMask);
+      }
+    }
+
+    printf("%4dx%-4d opencv %7.3lfms  fused %7.3lfms  speedup %5.2lfx  differing pixels %llu\n",
+           size.width, size.height, referenceMs / rounds, fusedMs / rounds, referenceMs / fusedMs,
+           (unsigned long long)differences);
+    totalDifferences += differences;
+  }
+
+  benchmarkBackgroundModel(sizes, sizeof(sizes) / sizeof(sizes[0]));
+  totalDifferences += benchmarkBands(sizes, sizeof(sizes) / sizeof(sizes[0]));
+  totalDifferences += checkRegions(sizes, sizeof(sizes) / sizeof(sizes[0]));
+  totalDifferences += checkCoarse(sizes, sizeof(sizes) / sizeof(sizes[0]));
+
+  return totalDifferences == 0 ? 0 : 1;
+}
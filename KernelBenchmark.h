@@ -0,0 +1,46 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef KERNEL_BENCHMARK_H_INCLUDED
+#define KERNEL_BENCHMARK_H_INCLUDED
+
+/**
+   Compares FusedMotionKernel with the OpenCV chain it replaces on generated
+   frames of several camera resolutions. Prints the time per frame of both
+   and the speedup, and counts the mask pixels that differ.
+
+   Then compares the time of BackgroundModel, update and difference, with
+   the plain cv::absdiff of two frames it replaces, and measures how the
+   per pixel work scales from 1 to N threads of a BandPool. Then the mask
+   of random regions, many touching the image border, is compared with the
+   OpenCV chain on the whole image. Last it prints how much of the full
+   mask the CoarseMotion check loses on small changes of low contrast.
+
+   Returns 0 if both mask kernels, all thread counts and all regions
+   produced identical masks everywhere, and the coarse check added no mask
+   pixels, 1 otherwise, so it can be run as a self check with
+   "qtmotion --benchmark-kernel". What the coarse check loses is only
+   reported.
+ */
+int runKernelBenchmark();
+
+
+#endif
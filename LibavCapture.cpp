@@ -0,0 +1,247 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "LibavCapture.h"
+
+#include <cstdio>
+
+#include "PacketRecorder.h"
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+// avcodec_send_packet() and AVStream::codecpar, see the requirement in CMakeLists.txt
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(57, 48, 101)
+#error "the libav capture engine needs FFmpeg 3.1 or newer"
+#endif
+
+LibavCapture::LibavCapture(const std::string& url, const cv::Size& size, const MotionSettings& settings,
+                           const std::shared_ptr<FrameRing>& ring, const FrameCallback& frameCallback)
+  : ThreadedFrameSource(url, size, settings, ring, frameCallback),
+  // anything with a protocol other than file:// arrives in real time by itself
+  live(url.find("://") != std::string::npos && url.compare(0, 7, "file://") != 0),
+  formatContext(NULL),
+  codecContext(NULL),
+  swsContext(NULL),
+  frame(NULL),
+  videoStreamIndex(-1),
+  lastPts(0)
+{ }
+
+
+LibavCapture::~LibavCapture()
+{
+  stop();
+}
+
+
+bool LibavCapture::setPacketRecorder(const std::shared_ptr<PacketRecorder>& recorder)
+{
+  packetRecorder = recorder;
+  return true;
+}
+
+
+int LibavCapture::interruptCallback(void* opaque)
+{
+  // lets stop() abort a blocking read or a connection attempt
+  return ((LibavCapture*)opaque)->stopRequested.load() ? 1 : 0;
+}
+
+
+void LibavCapture::run()
+{
+  if (openStream())
+  {
+    AVPacket* packet = av_packet_alloc();
+
+    while (!stopRequested && av_read_frame(formatContext, packet) >= 0)
+    {
+      if (packet->stream_index == videoStreamIndex && packetRecorder)
+      {
+        packetRecorder->writePacket(packet);
+      }
+      if (packet->stream_index == videoStreamIndex &&
+          avcodec_send_packet(codecContext, packet) == 0)
+      {
+        while (avcodec_receive_frame(codecContext, frame) == 0)
+        {
+          deliverFrame();
+        }
+      }
+      av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+    printf("libav: end of stream '%s'\n", url.c_str());
+  }
+
+  closeStream();
+}
+
+
+bool LibavCapture::openStream()
+{
+  formatContext = avformat_alloc_context();
+  formatContext->interrupt_callback.callback = &LibavCapture::interruptCallback;
+  formatContext->interrupt_callback.opaque = this;
+
+  // keep the demuxer from buffering and from probing longer than needed
+  AVDictionary* options = NULL;
+  av_dict_set(&options, "fflags", "nobuffer", 0);
+  av_dict_set_int(&options, "probesize", settings.probeSize, 0);
+  av_dict_set_int(&options, "analyzeduration", settings.analyzeDurationUs, 0);
+
+  const int openResult = avformat_open_input(&formatContext, url.c_str(), NULL, &options);
+  av_dict_free(&options);
+  if (openResult < 0)
+  {
+    // avformat_open_input frees the context on failure
+    formatContext = NULL;
+    printf("libav: could not open '%s'\n", url.c_str());
+    return false;
+  }
+
+  if (avformat_find_stream_info(formatContext, NULL) < 0)
+  {
+    printf("libav: no stream info for '%s'\n", url.c_str());
+    return false;
+  }
+
+  // FFmpeg 5 hands out the decoders as const
+#if LIBAVFORMAT_VERSION_MAJOR >= 59
+  const AVCodec* codec = NULL;
+#else
+  AVCodec* codec = NULL;
+#endif
+  videoStreamIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+  if (videoStreamIndex < 0)
+  {
+    printf("libav: no video stream in '%s'\n", url.c_str());
+    return false;
+  }
+
+  codecContext = avcodec_alloc_context3(codec);
+  avcodec_parameters_to_context(codecContext, formatContext->streams[videoStreamIndex]->codecpar);
+
+  // output every picture as soon as it is decoded. Frame threading would
+  // add a delay of one frame per thread, slice threading does not.
+  codecContext->flags |= AV_CODEC_FLAG_LOW_DELAY;
+  codecContext->flags2 |= AV_CODEC_FLAG2_FAST;
+  codecContext->thread_type = FF_THREAD_SLICE;
+
+  if (avcodec_open2(codecContext, codec, NULL) < 0)
+  {
+    printf("libav: could not open decoder for '%s'\n", url.c_str());
+    return false;
+  }
+
+  frame = av_frame_alloc();
+  if (packetRecorder)
+  {
+    const AVStream* stream = formatContext->streams[videoStreamIndex];
+    packetRecorder->setStream(stream->codecpar, stream->time_base.num, stream->time_base.den);
+  }
+  printf("libav: opened '%s' %dx%d\n", url.c_str(), codecContext->width, codecContext->height);
+  return true;
+}
+
+
+void LibavCapture::closeStream()
+{
+  if (packetRecorder)
+  {
+    packetRecorder->endStream();
+  }
+  if (swsContext)
+  {
+    sws_freeContext(swsContext);
+    swsContext = NULL;
+  }
+  if (frame)
+  {
+    av_frame_free(&frame);
+  }
+  if (codecContext)
+  {
+    avcodec_free_context(&codecContext);
+  }
+  if (formatContext)
+  {
+    avformat_close_input(&formatContext);
+  }
+  videoStreamIndex = -1;
+}
+
+
+void LibavCapture::deliverFrame()
+{
+  int64_t pts = frame->best_effort_timestamp;
+  if (pts != AV_NOPTS_VALUE)
+  {
+    pts = av_rescale_q(pts, formatContext->streams[videoStreamIndex]->time_base, AV_TIME_BASE_Q);
+    lastPts = pts;
+  }
+  else
+  {
+    // frames without a timestamp are treated as due right after the previous one
+    pts = lastPts;
+  }
+
+  if (!live && !pace(pts))
+  {
+    return;
+  }
+
+  const bool luma = settings.captureFormat == MotionSettings::CaptureLuma;
+  const AVPixelFormat outputFormat = luma ? AV_PIX_FMT_YUV420P : AV_PIX_FMT_BGR24;
+
+  // scaling happens once, here, from the decoder's native picture
+  swsContext = sws_getCachedContext(swsContext, frame->width, frame->height, (AVPixelFormat)frame->format,
+                                    size.width, size.height, outputFormat, SWS_AREA, NULL, NULL, NULL);
+  if (!swsContext)
+  {
+    return;
+  }
+
+  const int lumaBytes = size.width * size.height;
+  uint8_t* buffer = frameRing->beginWrite(luma ? lumaBytes * 3 / 2 : lumaBytes * 3);
+
+  uint8_t* planes[4] = { buffer, NULL, NULL, NULL };
+  int strides[4] = { size.width * 3, 0, 0, 0 };
+  if (luma)
+  {
+    // same layout as VLC's I420: Y, then U and V at quarter resolution
+    planes[1] = buffer + lumaBytes;
+    planes[2] = buffer + lumaBytes + lumaBytes / 4;
+    strides[0] = size.width;
+    strides[1] = size.width / 2;
+    strides[2] = size.width / 2;
+  }
+
+  sws_scale(swsContext, frame->data, frame->linesize, 0, frame->height, planes, strides);
+
+  deliver(size, pts);
+}
@@ -0,0 +1,78 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef LIBAV_CAPTURE_H_INCLUDED
+#define LIBAV_CAPTURE_H_INCLUDED
+
+#include "FrameSource.h"
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVFrame;
+struct SwsContext;
+
+/**
+   Capture engine that reads the stream with libavformat and decodes it with
+   libavcodec on its own thread, bypassing VLC's network caching and clock
+   handling.
+
+   Decoded pictures are scaled to the detection size with libswscale straight
+   into the FrameRing, in the same layout the VLC smem path produces, together
+   with their presentation timestamp in microseconds. Local files are paced
+   according to MotionSettings::pacing, network streams are not.
+ */
+class LibavCapture : public ThreadedFrameSource
+{
+public:
+
+  LibavCapture(const std::string& url, const cv::Size& size, const MotionSettings& settings,
+               const std::shared_ptr<FrameRing>& ring, const FrameCallback& frameCallback);
+  virtual ~LibavCapture();
+
+  virtual bool setPacketRecorder(const std::shared_ptr<PacketRecorder>& recorder);
+
+protected:
+
+  virtual void run();
+
+private:
+
+  bool openStream();
+  void closeStream();
+  void deliverFrame();
+
+  static int interruptCallback(void* opaque);
+
+  const bool live;
+
+  //receives the video packets before they are decoded, may be NULL
+  std::shared_ptr<PacketRecorder> packetRecorder;
+
+  AVFormatContext* formatContext;
+  AVCodecContext* codecContext;
+  SwsContext* swsContext;
+  AVFrame* frame;
+  int videoStreamIndex;
+  int64_t lastPts;
+};
+
+
+#endif
@@ -0,0 +1,143 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "LoadGovernor.h"
+
+#include <cstdio>
+
+const int64_t LoadGovernor::WINDOW_US;
+const int LoadGovernor::UP_PERCENT;
+const int LoadGovernor::LOSS_PERCENT;
+const uint32_t LoadGovernor::UP_WINDOWS;
+
+const LoadGovernor::Step LoadGovernor::STEPS[] =
+{
+  { 1, true, true, "every frame" },
+  { 2, true, true, "every second frame" },
+  { 2, false, true, "every second frame, frame differencing" },
+  { 3, false, true, "every third frame, frame differencing" },
+  { 4, false, true, "every fourth frame, frame differencing" },
+  { 4, false, false, "every fourth frame, frame differencing, not recording" }
+};
+
+const unsigned int LoadGovernor::STEP_COUNT = sizeof(STEPS) / sizeof(STEPS[0]);
+
+
+LoadGovernor::LoadGovernor(int budgetPercent_)
+  : budgetPercent(budgetPercent_),
+  workUs(0),
+  currentLevel(0),
+  lastLoad(0),
+  windowStartUs(0),
+  windowLost(0),
+  windowFrames(0),
+  windowQueued(0),
+  quietWindows(0)
+{ }
+
+
+void LoadGovernor::addWork(int64_t us)
+{
+  workUs += us;
+}
+
+
+void LoadGovernor::update(int64_t nowUs, uint64_t lost, unsigned int queued)
+{
+  if (windowStartUs == 0)
+  {
+    windowStartUs = nowUs;
+    windowLost = lost;
+    workUs = 0;
+    return;
+  }
+  windowFrames += 1;
+  windowQueued += queued;
+  if (nowUs - windowStartUs < WINDOW_US)
+  {
+    return;
+  }
+
+  const int load = int(workUs.exchange(0) * 100 / (nowUs - windowStartUs));
+  const uint64_t lostInWindow = lost - windowLost;
+  const bool losing = lostInWindow * 100 > (lostInWindow + windowFrames) * LOSS_PERCENT ||
+                      windowQueued > windowFrames;
+  windowStartUs = nowUs;
+  windowLost = lost;
+  windowFrames = 0;
+  windowQueued = 0;
+  lastLoad = load;
+  if (budgetPercent <= 0)
+  {
+    return;
+  }
+
+  //frames that get lost or queue up mean a stage cannot keep up, whatever the load says
+  const bool quiet = load * 100 < budgetPercent * UP_PERCENT && !losing;
+  quietWindows = quiet ? quietWindows + 1 : 0;
+  unsigned int level = currentLevel;
+  if ((load > budgetPercent || losing) && level + 1 < STEP_COUNT)
+  {
+    level += 1;
+  }
+  else if (quietWindows >= UP_WINDOWS && level > 0)
+  {
+    level -= 1;
+    quietWindows = 0;
+  }
+  else
+  {
+    return;
+  }
+
+  currentLevel = level;
+  printf("detection load %d%% of %d%%, step %u: %s\n", load, budgetPercent, level, STEPS[level].description);
+}
+
+
+bool LoadGovernor::processFrame(uint64_t n) const
+{
+  return n % STEPS[currentLevel].frameRatio == 0;
+}
+
+
+bool LoadGovernor::backgroundModel() const
+{
+  return STEPS[currentLevel].backgroundModel;
+}
+
+
+bool LoadGovernor::recording() const
+{
+  return STEPS[currentLevel].recording;
+}
+
+
+unsigned int LoadGovernor::level() const
+{
+  return currentLevel;
+}
+
+
+int LoadGovernor::load() const
+{
+  return lastLoad;
+}
@@ -0,0 +1,119 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef LOAD_GOVERNOR_H_INCLUDED
+#define LOAD_GOVERNOR_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+
+/**
+   Keeps the detection inside a share of the CPU by stepping down what it
+   does per second, and back up once there is room again.
+
+   The stages add the time they spent working on frames, and the blob stage
+   hands in how many frames were lost so far and how many wait in the
+   FrameRing. Every WINDOW_US the work is set against the time passed. A
+   load above the budget, more than LOSS_PERCENT of the frames lost, or
+   frames queueing up on average, takes one step down. A single lost frame
+   is a hiccup, not a reason to step down. A load below UP_PERCENT of the
+   budget without losses takes one step up, but only after UP_WINDOWS such
+   windows in a row, so a source that loses frames for other reasons than
+   the CPU does not make the level swing. Each step keeps the savings of
+   the ones before it:
+
+   0 every frame, everything as configured
+   1 every second frame
+   2 frame differencing instead of the background model
+   3 every third frame
+   4 every fourth frame
+   5 no frames handed to the recording
+
+   The load is in percent of one core, the band threads of the per pixel
+   work are not counted separately. A budget of 0 disables the governor.
+ */
+class LoadGovernor
+{
+public:
+
+  //time the load is averaged over
+  static const int64_t WINDOW_US = 2000000;
+  //a load below this share of the budget takes one step up
+  static const int UP_PERCENT = 50;
+  //share of lost frames in a window that counts as not keeping up
+  static const int LOSS_PERCENT = 10;
+  //windows in a row below UP_PERCENT before a step up
+  static const uint32_t UP_WINDOWS = 2;
+
+  /** What the detection does at one step. */
+  struct Step
+  {
+    //one in this many frames is processed
+    unsigned int frameRatio;
+    //the background model may be used, see MotionSettings::DetectBackground
+    bool backgroundModel;
+    //frames are handed to the recording
+    bool recording;
+    const char* description;
+  };
+
+  explicit LoadGovernor(int budgetPercent);
+
+  /** Any stage: adds time spent working on a frame. */
+  void addWork(int64_t us);
+
+  /**
+     Blob stage, once per processed frame: lost counts the frames dropped so
+     far, queued the ones waiting for the detection now.
+   */
+  void update(int64_t nowUs, uint64_t lost, unsigned int queued);
+
+  /** Convert stage: whether the n-th frame taken from the ring is processed. */
+  bool processFrame(uint64_t n) const;
+
+  bool backgroundModel() const;
+  bool recording() const;
+
+  unsigned int level() const;
+  /** Load of the last window, in percent of one core. */
+  int load() const;
+
+private:
+
+  static const Step STEPS[];
+  static const unsigned int STEP_COUNT;
+
+  const int budgetPercent;
+  std::atomic<int64_t> workUs;
+  std::atomic<unsigned int> currentLevel;
+  std::atomic<int> lastLoad;
+
+  //state of the blob stage
+  int64_t windowStartUs;
+  uint64_t windowLost;
+  uint32_t windowFrames;
+  uint64_t windowQueued;
+  //windows in a row that allowed a step up
+  uint32_t quietWindows;
+};
+
+
+#endif
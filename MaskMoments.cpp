@@ -0,0 +1,161 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "MaskMoments.h"
+
+#include <algorithm>
+#include <cmath>
+
+/** Counts the set pixels of a band of rows. */
+class MaskMomentsJob : public BandJob
+{
+public:
+
+  MaskMomentsJob(MaskMoments& moments_, const cv::Mat& mask_, unsigned int bands_)
+    : moments(moments_), mask(mask_), bands(bands_)
+  { }
+
+
+  virtual void operator()(unsigned int band, unsigned int thread) const
+  {
+    const int width = mask.cols;
+    const int begin = mask.rows * band / bands;
+    const int end = mask.rows * (band + 1) / bands;
+    uint32_t* counts = &moments.columnCounts[thread * width];
+    for (int y = begin; y < end; ++y)
+    {
+      const uint8_t* row = mask.ptr<uint8_t>(y);
+      uint32_t rowCount = 0;
+      for (int x = 0; x < width; ++x)
+      {
+        // mask pixels are either 0 or 255
+        const uint32_t set = row[x] >> 7;
+        counts[x] += set;
+        rowCount += set;
+      }
+      moments.rowCounts[y] = rowCount;
+    }
+  }
+
+private:
+
+  MaskMoments& moments;
+  const cv::Mat& mask;
+  const unsigned int bands;
+};
+
+
+MaskMoments::MaskMoments(BandPool* pool_)
+  : area(0), centroidX(0), centroidY(0), spreadX(0), spreadY(0), pool(pool_)
+{ }
+
+
+bool MaskMoments::compute(const cv::Mat& mask)
+{
+  const int width = mask.cols;
+  const int height = mask.rows;
+  const unsigned int threads = pool ? pool->threads() : 1;
+  columnCounts.assign(threads * width, 0);
+  rowCounts.resize(height);
+  if (width == 0 || height == 0)
+  {
+    area = 0;
+    boundingRect = cv::Rect();
+    return false;
+  }
+
+  const unsigned int bands = std::min<unsigned int>(threads, height);
+  const MaskMomentsJob job(*this, mask, bands);
+  if (pool)
+  {
+    pool->run(bands, job);
+  }
+  else
+  {
+    job(0, 0);
+  }
+
+  uint32_t* counts = &columnCounts[0];
+  for (unsigned int thread = 1; thread < threads; ++thread)
+  {
+    const uint32_t* other = &columnCounts[thread * width];
+    for (int x = 0; x < width; ++x)
+    {
+      counts[x] += other[x];
+    }
+  }
+
+  // rows: count, sum of y, sum of y^2 and extent
+  uint64_t total = 0;
+  uint64_t sumY = 0;
+  uint64_t sumYY = 0;
+  int top = height;
+  int bottom = -1;
+  for (int y = 0; y < height; ++y)
+  {
+    const uint32_t rowCount = rowCounts[y];
+    if (rowCount)
+    {
+      total += rowCount;
+      sumY += uint64_t(rowCount) * y;
+      sumYY += uint64_t(rowCount) * y * y;
+      if (top == height)
+      {
+        top = y;
+      }
+      bottom = y;
+    }
+  }
+
+  area = uint32_t(total);
+  if (!total)
+  {
+    centroidX = centroidY = spreadX = spreadY = 0;
+    boundingRect = cv::Rect();
+    return false;
+  }
+
+  // columns: the same from the column counts
+  uint64_t sumX = 0;
+  uint64_t sumXX = 0;
+  int left = width;
+  int right = -1;
+  for (int x = 0; x < width; ++x)
+  {
+    if (counts[x])
+    {
+      sumX += uint64_t(counts[x]) * x;
+      sumXX += uint64_t(counts[x]) * x * x;
+      if (left == width)
+      {
+        left = x;
+      }
+      right = x;
+    }
+  }
+
+  centroidX = double(sumX) / total;
+  centroidY = double(sumY) / total;
+  spreadX = std::sqrt(std::max(0.0, double(sumXX) / total - centroidX * centroidX));
+  spreadY = std::sqrt(std::max(0.0, double(sumYY) / total - centroidY * centroidY));
+  boundingRect = cv::Rect(left, top, right - left + 1, bottom - top + 1);
+  return true;
+}
@@ -0,0 +1,80 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MASK_MOMENTS_H_INCLUDED
+#define MASK_MOMENTS_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <cstdint>
+#include <vector>
+
+#include "BandPool.h"
+
+/**
+   Zeroth, first and second order moments of a binary motion mask, all set
+   pixels taken as one target.
+
+   One pass over the mask adds every row to per column counts and sums the
+   row, both in the same loop the compiler vectorises. The moments, the
+   bounding box and the spread are then derived from the row and column
+   counts, so the cost only depends on the image size and not on how noisy
+   the mask is, unlike contour tracing. With a BandPool the rows are split
+   into bands, each thread adds into column counts of its own which are
+   summed up afterwards.
+
+   An instance owns its count buffers and must only be used by one thread
+   at a time.
+ */
+class MaskMoments
+{
+public:
+
+  /** pool may be NULL to run on the calling thread only. */
+  explicit MaskMoments(BandPool* pool = NULL);
+
+  /** Measures the set pixels of mask, an 8 bit image of 0 and 255. False if none is set. */
+  bool compute(const cv::Mat& mask);
+
+  //number of set pixels
+  uint32_t area;
+  //centre of mass of the set pixels
+  double centroidX;
+  double centroidY;
+  //standard deviation of the set pixels around the centroid
+  double spreadX;
+  double spreadY;
+  //smallest rectangle containing all set pixels
+  cv::Rect boundingRect;
+
+private:
+
+  friend class MaskMomentsJob;
+
+  BandPool* const pool;
+
+  //set pixels per column of the mask, one row of counts per thread of the pool
+  std::vector<uint32_t> columnCounts;
+  //set pixels per row of the mask
+  std::vector<uint32_t> rowCounts;
+};
+
+
+#endif
@@ -0,0 +1,192 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ * Based on code (motionTracking.cpp) written by Kyle Hounslow, December 2013
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "MotionDetector.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+/** Computes the mask of one band with the kernel of the calling thread. */
+class ThresholdJob : public BandJob
+{
+public:
+
+  ThresholdJob(MotionDetector& detector_, const cv::Mat& last_, const cv::Mat& current_, cv::Mat& mask_)
+    : detector(detector_), last(last_), current(current_), mask(mask_)
+  { }
+
+
+  virtual void operator()(unsigned int band, unsigned int thread) const
+  {
+    detector.kernels[thread].apply(last.data, last.step, current.data, current.step, current.size(),
+                                   mask.data, mask.step, detector.bands[band]);
+  }
+
+private:
+
+  MotionDetector& detector;
+  const cv::Mat& last;
+  const cv::Mat& current;
+  cv::Mat& mask;
+};
+
+
+MotionDetector::MotionDetector(uint32_t minBlobArea_, BandPool* pool_)
+  : minBlobArea(minBlobArea_),
+  pool(pool_),
+  kernels(pool_ ? pool_->threads() : 1, FusedMotionKernel(SENSITIVITY_VALUE, BLUR_SIZE)),
+  moments(pool_),
+  searchCapped(false)
+{ }
+
+
+void MotionDetector::computeThreshold(const cv::Mat& lastGrayImage, const cv::Mat& currentGrayImage,
+                                      cv::Mat& thresholdImage)
+{
+  if (!kernels[0].supports(currentGrayImage.size()))
+  {
+    computeThresholdReference(lastGrayImage, currentGrayImage, thresholdImage);
+    return;
+  }
+
+  thresholdImage.create(currentGrayImage.rows, currentGrayImage.cols, CV_8UC1);
+  bands.clear();
+  addBands(cv::Rect(0, 0, currentGrayImage.cols, currentGrayImage.rows));
+  runBands(lastGrayImage, currentGrayImage, thresholdImage);
+}
+
+
+void MotionDetector::computeThreshold(const cv::Mat& lastGrayImage, const cv::Mat& currentGrayImage,
+                                      const std::vector<cv::Rect>& regions, cv::Mat& thresholdImage)
+{
+  if (!kernels[0].supports(currentGrayImage.size()))
+  {
+    computeThresholdReference(lastGrayImage, currentGrayImage, thresholdImage);
+    return;
+  }
+
+  thresholdImage.create(currentGrayImage.rows, currentGrayImage.cols, CV_8UC1);
+  thresholdImage.setTo(Scalar(0));
+  bands.clear();
+  for (size_t i = 0; i < regions.size(); ++i)
+  {
+    addBands(regions[i]);
+  }
+  runBands(lastGrayImage, currentGrayImage, thresholdImage);
+}
+
+
+void MotionDetector::addBands(const cv::Rect& region)
+{
+  //every band primes its box with BLUR_SIZE rows, small bands are not worth it
+  const int count = std::max(1, std::min<int>(kernels.size(), region.height / MIN_BAND_ROWS));
+  for (int i = 0; i < count; ++i)
+  {
+    const int begin = region.y + region.height * i / count;
+    const int end = region.y + region.height * (i + 1) / count;
+    bands.push_back(cv::Rect(region.x, begin, region.width, end - begin));
+  }
+}
+
+
+void MotionDetector::runBands(const cv::Mat& lastGrayImage, const cv::Mat& currentGrayImage, cv::Mat& thresholdImage)
+{
+  const ThresholdJob job(*this, lastGrayImage, currentGrayImage, thresholdImage);
+  if (pool)
+  {
+    pool->run(bands.size(), job);
+  }
+  else
+  {
+    for (size_t i = 0; i < bands.size(); ++i)
+    {
+      job(i, 0);
+    }
+  }
+}
+
+
+void MotionDetector::computeThresholdReference(const cv::Mat& lastGrayImage, const cv::Mat& currentGrayImage,
+                                               cv::Mat& thresholdImage)
+{
+  //perform frame differencing with the sequential images. This will output an "intensity image"
+  //do not confuse this with a threshold image, we will need to perform thresholding afterwards.
+  cv::absdiff(lastGrayImage, currentGrayImage, differenceImage);
+  //threshold intensity image at a given sensitivity value
+  cv::threshold(differenceImage, thresholdImage, SENSITIVITY_VALUE, 255, THRESH_BINARY);
+  //blur the image to get rid of the noise. This will output an intensity image
+  cv::blur(thresholdImage, thresholdImage, cv::Size(BLUR_SIZE, BLUR_SIZE));
+  //threshold again to obtain binary image from blur output
+  cv::threshold(thresholdImage, thresholdImage, SENSITIVITY_VALUE, 255, THRESH_BINARY);
+}
+
+
+bool MotionDetector::searchForMovement(const cv::Mat& thresholdImage, const cv::Rect& searchRect,
+                                       std::vector<Blob>& blobs)
+{
+  //the region shares the image's pixels, the blobs are moved back into image coordinates
+  const Mat region(thresholdImage, searchRect);
+  searchCapped = !components.compute(region, std::max<uint32_t>(minBlobArea, 1), blobs, MAX_RUNS, MAX_BLOBS);
+  if (searchCapped)
+  {
+    //too much noise to tell objects apart in time, the moments cost the same for any mask
+    return measureMovement(thresholdImage, searchRect, blobs);
+  }
+  for (size_t i = 0; i < blobs.size(); ++i)
+  {
+    blobs[i].centroidX += searchRect.x;
+    blobs[i].centroidY += searchRect.y;
+    blobs[i].boundingRect.x += searchRect.x;
+    blobs[i].boundingRect.y += searchRect.y;
+  }
+  return !blobs.empty();
+}
+
+
+bool MotionDetector::capped() const
+{
+  return searchCapped;
+}
+
+
+bool MotionDetector::measureMovement(const cv::Mat& thresholdImage, const cv::Rect& searchRect,
+                                     std::vector<Blob>& blobs)
+{
+  blobs.clear();
+  const Mat region(thresholdImage, searchRect);
+  if (!moments.compute(region) || moments.area < minBlobArea)
+  {
+    return false;
+  }
+
+  Blob blob;
+  blob.area = moments.area;
+  blob.centroidX = moments.centroidX + searchRect.x;
+  blob.centroidY = moments.centroidY + searchRect.y;
+  blob.boundingRect = moments.boundingRect;
+  blob.boundingRect.x += searchRect.x;
+  blob.boundingRect.y += searchRect.y;
+  blobs.push_back(blob);
+  return true;
+}
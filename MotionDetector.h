@@ -0,0 +1,118 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ * Based on code (motionTracking.cpp) written by Kyle Hounslow, December 2013
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MOTION_DETECTOR_H_INCLUDED
+#define MOTION_DETECTOR_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <cstdint>
+#include <vector>
+
+#include "BandPool.h"
+#include "ConnectedComponents.h"
+#include "FusedMotionKernel.h"
+#include "MaskMoments.h"
+
+/**
+   The image processing of the motion tracking, split into the two steps the
+   DetectionPipeline runs on separate threads: building the binary motion
+   mask from two gray frames, and finding the object in that mask.
+
+   With a BandPool the mask and its moments are computed in row bands on
+   all threads of the pool. The mask kernel reads the rows its box needs
+   around a band itself, so the bands need no overlap.
+ */
+class MotionDetector
+{
+public:
+
+//our sensitivity value to be used in the absdiff() function
+  static const int SENSITIVITY_VALUE = 40;
+//size of blur used to smooth the intensity image output from absdiff() function
+  const static int BLUR_SIZE = 10;
+  //runs of a mask searchForMovement() still labels, a mask full of rain has more
+  static const uint32_t MAX_RUNS = 8192;
+  //blobs searchForMovement() returns at most, the tracker only looks at the largest
+  static const size_t MAX_BLOBS = 32;
+
+  /**
+     Motion of fewer than minBlobArea pixels of the threshold image is
+     ignored. pool may be NULL to run on the calling thread only.
+   */
+  explicit MotionDetector(uint32_t minBlobArea = 0, BandPool* pool = NULL);
+
+  /** Frame differencing, threshold, blur and a second threshold, in one pass by FusedMotionKernel. */
+  void computeThreshold(const cv::Mat& lastGrayImage, const cv::Mat& currentGrayImage, cv::Mat& thresholdImage);
+
+  /** The same, but only inside regions, the rest of the mask is cleared. */
+  void computeThreshold(const cv::Mat& lastGrayImage, const cv::Mat& currentGrayImage,
+                        const std::vector<cv::Rect>& regions, cv::Mat& thresholdImage);
+
+  /** The same with the OpenCV functions, one pass each. */
+  void computeThresholdReference(const cv::Mat& lastGrayImage, const cv::Mat& currentGrayImage,
+                                 cv::Mat& thresholdImage);
+
+  /**
+     Finds the separate objects inside searchRect of the threshold image,
+     largest first, in image coordinates. False if there is none. A mask
+     with more than MAX_RUNS runs is measured like measureMovement() does,
+     see capped().
+   */
+  bool searchForMovement(const cv::Mat& thresholdImage, const cv::Rect& searchRect, std::vector<Blob>& blobs);
+
+  /** True if the last searchForMovement() gave up labelling at MAX_RUNS. */
+  bool capped() const;
+
+  /**
+     Takes all motion inside searchRect of the threshold image as one
+     object, blobs holds only that one. Much cheaper than searchForMovement()
+     on a noisy mask, but cannot tell several objects apart.
+   */
+  bool measureMovement(const cv::Mat& thresholdImage, const cv::Rect& searchRect, std::vector<Blob>& blobs);
+
+private:
+
+  void addBands(const cv::Rect& region);
+  void runBands(const cv::Mat& lastGrayImage, const cv::Mat& currentGrayImage, cv::Mat& thresholdImage);
+
+  //rows of the smallest band worth a thread of its own
+  static const int MIN_BAND_ROWS = 24;
+
+  friend class ThresholdJob;
+
+  const uint32_t minBlobArea;
+  BandPool* const pool;
+
+  //one kernel per thread of the pool, they own row buffers
+  std::vector<FusedMotionKernel> kernels;
+  //the regions of the current computeThreshold() split into bands
+  std::vector<cv::Rect> bands;
+  MaskMoments moments;
+  ConnectedComponents components;
+  bool searchCapped;
+
+  //resulting difference image
+  cv::Mat differenceImage;
+};
+
+
+#endif
@@ -0,0 +1,219 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "MotionHistory.h"
+
+#include <algorithm>
+
+const int64_t MotionHistory::TICK_US;
+const int64_t MotionHistory::DURATION_US;
+const int64_t MotionHistory::TRAIL_US;
+const int MotionHistory::MAX_SPEED;
+const uint32_t MotionHistory::MIN_PIXELS;
+
+namespace
+{
+
+//stamps run from 1 to STAMP_RANGE, 0 is no motion
+const int STAMP_RANGE = 65535;
+const int DURATION_TICKS = int(MotionHistory::DURATION_US / MotionHistory::TICK_US);
+const int TRAIL_TICKS = int(MotionHistory::TRAIL_US / MotionHistory::TICK_US);
+//a trail cut off on one side would bend the fit
+const int TRAIL_MARGIN = int(MotionHistory::MAX_SPEED * MotionHistory::TRAIL_US / 1000000);
+
+
+uint16_t tick(int64_t pts)
+{
+  return uint16_t(pts / MotionHistory::TICK_US % STAMP_RANGE + 1);
+}
+
+}
+
+
+/** Stamps and clears a band of rows. */
+class MotionHistoryJob : public BandJob
+{
+public:
+
+  MotionHistoryJob(MotionHistory& history_, const cv::Mat& mask_, unsigned int bands_)
+    : history(history_), mask(mask_), bands(bands_)
+  { }
+
+
+  virtual void operator()(unsigned int band, unsigned int) const
+  {
+    const int begin = mask.rows * band / bands;
+    const int end = mask.rows * (band + 1) / bands;
+    const uint16_t now = history.now;
+    for (int y = begin; y < end; ++y)
+    {
+      const uint8_t* row = mask.ptr<uint8_t>(y);
+      uint16_t* stamps = history.stamps.ptr<uint16_t>(y);
+      for (int x = 0; x < mask.cols; ++x)
+      {
+        if (row[x])
+        {
+          stamps[x] = now;
+        }
+        else if (stamps[x] && history.age(stamps[x]) > DURATION_TICKS)
+        {
+          stamps[x] = 0;
+        }
+      }
+    }
+  }
+
+private:
+
+  MotionHistory& history;
+  const cv::Mat& mask;
+  const unsigned int bands;
+};
+
+
+MotionHistory::MotionHistory(const cv::Size& size, BandPool* pool_)
+  : pool(pool_),
+  stamps(size, CV_16UC1),
+  now(1),
+  newest(1),
+  lastPts(0),
+  hasLastPts(false)
+{
+  stamps.setTo(cv::Scalar(0));
+}
+
+
+void MotionHistory::reset()
+{
+  stamps.setTo(cv::Scalar(0));
+  hasLastPts = false;
+}
+
+
+uint16_t MotionHistory::age(uint16_t stamp) const
+{
+  return uint16_t((int(now) - int(stamp) + STAMP_RANGE) % STAMP_RANGE);
+}
+
+
+void MotionHistory::update(const cv::Mat& mask, int64_t pts)
+{
+  //after a longer gap, or a jump back, every stamp is too old anyway, and a
+  //stamp left over from before a wrap around could look recent
+  if (!hasLastPts || pts < lastPts || pts - lastPts > DURATION_US)
+  {
+    stamps.setTo(cv::Scalar(0));
+  }
+  lastPts = pts;
+  hasLastPts = true;
+  now = tick(pts);
+  newest = now;
+
+  const unsigned int bands = std::min<unsigned int>(pool ? pool->threads() : 1, mask.rows);
+  const MotionHistoryJob job(*this, mask, bands);
+  if (pool)
+  {
+    pool->run(bands, job);
+  }
+  else
+  {
+    job(0, 0);
+  }
+}
+
+
+void MotionHistory::advance(int64_t pts)
+{
+  //the stamps are only cleared in update(), once they are all too old they
+  //are dropped here, before a wrap around lets them look recent
+  if (hasLastPts && (pts < lastPts || pts - lastPts > DURATION_US))
+  {
+    stamps.setTo(cv::Scalar(0));
+    hasLastPts = false;
+  }
+  now = tick(pts);
+}
+
+
+bool MotionHistory::measure(const cv::Rect& rect, double& vx, double& vy) const
+{
+  vx = 0;
+  vy = 0;
+
+  //the trail lies behind the object, in whatever direction it came from
+  const int left = std::max(0, rect.x - TRAIL_MARGIN);
+  const int top = std::max(0, rect.y - TRAIL_MARGIN);
+  const int right = std::min(stamps.cols, rect.x + rect.width + TRAIL_MARGIN);
+  const int bottom = std::min(stamps.rows, rect.y + rect.height + TRAIL_MARGIN);
+
+  //position against age, ages in ticks
+  uint64_t count = 0;
+  int64_t sumA = 0;
+  int64_t sumAA = 0;
+  int64_t sumX = 0;
+  int64_t sumY = 0;
+  int64_t sumXA = 0;
+  int64_t sumYA = 0;
+  for (int y = top; y < bottom; ++y)
+  {
+    const uint16_t* row = stamps.ptr<uint16_t>(y);
+    for (int x = left; x < right; ++x)
+    {
+      //the newest stamps cover the whole object, only the trail behind it
+      //lies where the object was at the time of the stamp
+      if (!row[x] || row[x] == newest)
+      {
+        continue;
+      }
+      const int64_t a = age(row[x]);
+      if (a > TRAIL_TICKS)
+      {
+        continue;
+      }
+      count += 1;
+      sumA += a;
+      sumAA += a * a;
+      sumX += x;
+      sumY += y;
+      sumXA += x * a;
+      sumYA += y * a;
+    }
+  }
+
+  if (count < MIN_PIXELS)
+  {
+    return false;
+  }
+
+  const double n = double(count);
+  const double varianceA = sumAA / n - (sumA / n) * (sumA / n);
+  //everything stamped at once, there is no trail to follow
+  if (varianceA < 1.0)
+  {
+    return false;
+  }
+
+  //older stamps lie behind, the velocity is the negative slope over the age
+  const double ticksPerSecond = 1000000.0 / TICK_US;
+  vx = -(sumXA / n - (sumX / n) * (sumA / n)) / varianceA * ticksPerSecond;
+  vy = -(sumYA / n - (sumY / n) * (sumA / n)) / varianceA * ticksPerSecond;
+  return true;
+}
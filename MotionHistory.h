@@ -0,0 +1,103 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MOTION_HISTORY_H_INCLUDED
+#define MOTION_HISTORY_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <cstdint>
+
+#include "BandPool.h"
+
+/**
+   Motion history image: for every pixel of the detection image the time
+   motion was last seen there, from the threshold images of the frames.
+
+   The times are 16 bit ticks of TICK_US, 0 meaning no motion within
+   DURATION_US. Every update() stamps the set pixels of the mask and clears
+   the ones that got too old, so the ticks may wrap around without old
+   motion ever looking recent.
+
+   A mover leaves a trail of older and older stamps behind itself. measure()
+   fits the positions of the trail around an object against its age by
+   least squares, the slope is the direction and speed the object moved in
+   over the last DURATION_US. Unlike the tracker's velocity this needs no
+   history of the object itself, a walker entering the picture has a
+   direction after a few frames.
+
+   With a BandPool update() runs in row bands. An instance must only be
+   used by one thread at a time.
+ */
+class MotionHistory
+{
+public:
+
+  //length of a tick of the stamps
+  static const int64_t TICK_US = 4000;
+  //motion older than this is forgotten
+  static const int64_t DURATION_US = 1000000;
+  //trail measure() looks at
+  static const int64_t TRAIL_US = 300000;
+  //fastest motion measure() follows in full, in pixels per second
+  static const int MAX_SPEED = 160;
+  //fewer stamped pixels tell no direction
+  static const uint32_t MIN_PIXELS = 20;
+
+  /** pool may be NULL to run on the calling thread only. */
+  explicit MotionHistory(const cv::Size& size, BandPool* pool = NULL);
+
+  /** Forgets all motion, e.g. after the source restarted. */
+  void reset();
+
+  /**
+     Stamps the set pixels of mask, an 8 bit image of 0 and 255, with pts in
+     microseconds. Frames without any motion go to advance() instead.
+   */
+  void update(const cv::Mat& mask, int64_t pts);
+
+  /** Moves the time ages are measured from to pts without stamping anything. */
+  void advance(int64_t pts);
+
+  /**
+     Velocity of the motion in rect and the trail of the last TRAIL_US
+     around it, in pixels per second, as of the last update(). False if
+     there is too little motion to tell.
+   */
+  bool measure(const cv::Rect& rect, double& vx, double& vy) const;
+
+private:
+
+  friend class MotionHistoryJob;
+
+  uint16_t age(uint16_t stamp) const;
+
+  BandPool* const pool;
+  //stamps of the pixels, CV_16UC1
+  cv::Mat stamps;
+  uint16_t now;
+  //stamp of the last update(), later frames only move now
+  uint16_t newest;
+  int64_t lastPts;
+  bool hasLastPts;
+};
+
+
+#endif
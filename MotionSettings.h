@@ -0,0 +1,166 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MOTION_SETTINGS_H_INCLUDED
+#define MOTION_SETTINGS_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+
+/**
+   Runtime options of the motion tracking, filled from the qtmotion command
+   line and handed to QtMotionTracking::open().
+ */
+struct MotionSettings
+{
+  /** Pixel format requested from the decoder. */
+  enum CaptureFormat
+  {
+    CaptureLuma,    ///< planar I420, the luma plane is used for detection directly
+    CaptureColor    ///< packed 24 bit RGB as delivered by VLC's RV24 transcoder
+  };
+
+  /** Library used to receive and decode the stream. */
+  enum CaptureEngine
+  {
+    EngineVlc,      ///< libvlc with the smem output module
+    EngineLibav     ///< libavformat/libavcodec directly, see LibavCapture
+  };
+
+  /** Speed at which recorded input (files, dumps, synthetic frames) is played. */
+  enum Pacing
+  {
+    PaceRealtime,   ///< as the frames were captured, frames are dropped if detection is too slow
+    PaceFast        ///< as fast as detection keeps up, every frame is detected in order regardless of
+                    ///< backlogPolicy and maxFrameAgeMs
+  };
+
+  /** What the detector does when frames queue up faster than it processes them. */
+  enum BacklogPolicy
+  {
+    BacklogProcessAll,  ///< process every frame in the ring, oldest first
+    BacklogLatest       ///< skip to the newest frame, older ones are dropped
+  };
+
+  /** How frames with motion are recorded to the output file. */
+  enum RecordMode
+  {
+    RecordReencode,     ///< decoded frames with the bounding box drawn in, encoded again with XVID
+    RecordRemux         ///< the camera's compressed packets, one file per event, see PacketRecorder
+  };
+
+  /** What a frame is compared with to find the motion. */
+  enum DetectionMode
+  {
+    DetectDifference,   ///< the previous frame
+    DetectBackground    ///< a running average of the frames, see BackgroundModel
+  };
+
+  /** How the detector finds the target in the motion mask. */
+  enum TargetMode
+  {
+    TargetSingle,       ///< all motion is one target at its centre of mass, see MaskMoments, cheapest on noisy nights
+    TargetMultiple      ///< separate targets by connected component labelling, followed by the MotionTracker
+  };
+
+  MotionSettings()
+    : captureFormat(CaptureLuma),
+    captureEngine(EngineVlc),
+    probeSize(32768),
+    analyzeDurationUs(500000),
+    pacing(PaceRealtime),
+    frameRate(25.0),
+    backlogPolicy(BacklogLatest),
+    maxFrameAgeMs(500),
+    recordMode(RecordReencode),
+    preTriggerMs(3000),
+    postTriggerMs(2000),
+    preRollMemoryMb(16),
+    targetMode(TargetMultiple),
+    minBlobArea(20),
+    detectionMode(DetectDifference),
+    learningRate(0.02),
+    coarseCheck(false),
+    detectionThreads(0),
+    autoRoi(false),
+    frameBudgetMs(40),
+    cpuBudgetPercent(0),
+    classifyPeople(false)
+  { }
+
+
+  CaptureFormat captureFormat;
+  CaptureEngine captureEngine;
+
+  //libavformat probing limits, smaller values shorten the time until the first frame
+  int64_t probeSize;
+  int64_t analyzeDurationUs;
+
+  Pacing pacing;
+  //frame rate of inputs without timestamps
+  double frameRate;
+
+  //if set every captured frame is appended to this file
+  std::string dumpFile;
+
+  BacklogPolicy backlogPolicy;
+  //frames that waited longer than this are dropped, 0 disables the limit
+  int maxFrameAgeMs;
+
+  RecordMode recordMode;
+  //an event recording starts this long before the motion was seen
+  int preTriggerMs;
+  //an event recording ends once no motion was seen for this long
+  int postTriggerMs;
+  //memory limit of the frames or packets buffered for preTriggerMs
+  int preRollMemoryMb;
+
+  TargetMode targetMode;
+  //smaller motion, in pixels of the detection image, is taken as noise
+  uint32_t minBlobArea;
+
+  DetectionMode detectionMode;
+  //weight of a new frame in the background, DetectBackground only
+  double learningRate;
+  //compute the motion mask only where downsampled frames show a change, see CoarseMotion
+  bool coarseCheck;
+  //threads for the per pixel work of the detection, 0 is one per core
+  unsigned int detectionThreads;
+
+  //image or polygon file of the region motion is searched in, see RegionOfInterest
+  std::string roiFile;
+
+  //where the ActivityHeatmap is kept between runs, empty to not keep it
+  std::string heatmapFile;
+  //compute tiles without tracks in the heatmap less often
+  bool autoRoi;
+
+  //processing time of a frame from conversion to its blobs, a frame that
+  //reaches the blob search later reuses the previous result, 0 disables it
+  int frameBudgetMs;
+  //percent of one core the detection may use on average, see LoadGovernor, 0 disables it
+  int cpuBudgetPercent;
+  //ignore tracks the PersonClassifier does not take for a person
+  bool classifyPeople;
+};
+
+
+#endif
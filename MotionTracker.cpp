@@ -0,0 +1,267 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "MotionTracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+//variance of the acceleration of a walking person, (pixels/s^2)^2
+const double PROCESS_NOISE = 200.0 * 200.0;
+//variance of a blob's centroid, pixels^2
+const double MEASUREMENT_NOISE = 3.0 * 3.0;
+//variance of the velocity of a new track, (pixels/s)^2
+const double INITIAL_VELOCITY_VARIANCE = 150.0 * 150.0;
+//squared gate distance in standard deviations, 99% for two degrees of freedom
+const double GATE = 9.21;
+//a gap longer than this drops all tracks, seconds
+const double MAX_GAP = 1.0;
+
+struct Candidate
+{
+  double distance;
+  unsigned int entry;
+  unsigned int blob;
+};
+
+
+bool closerCandidate(const Candidate& a, const Candidate& b)
+{
+  return a.distance < b.distance;
+}
+
+}
+
+
+void MotionTracker::Axis::init(double position_)
+{
+  position = position_;
+  velocity = 0;
+  pp = MEASUREMENT_NOISE;
+  pv = 0;
+  vv = INITIAL_VELOCITY_VARIANCE;
+}
+
+
+void MotionTracker::Axis::predict(double dt)
+{
+  // x' = F x, P' = F P F^T + Q for F = [1 dt; 0 1] and white acceleration noise
+  position += velocity * dt;
+  const double dt2 = dt * dt;
+  pp += 2 * dt * pv + dt2 * vv + PROCESS_NOISE * dt2 * dt2 / 4;
+  pv += dt * vv + PROCESS_NOISE * dt2 * dt / 2;
+  vv += PROCESS_NOISE * dt2;
+}
+
+
+void MotionTracker::Axis::update(double measurement)
+{
+  const double s = innovationVariance();
+  const double kp = pp / s;
+  const double kv = pv / s;
+  const double innovation = measurement - position;
+  position += kp * innovation;
+  velocity += kv * innovation;
+  // P = (I - K H) P
+  vv -= kv * pv;
+  pv -= kp * pv;
+  pp -= kp * pp;
+}
+
+
+double MotionTracker::Axis::innovationVariance() const
+{
+  return pp + MEASUREMENT_NOISE;
+}
+
+
+MotionTracker::MotionTracker()
+  : nextId(1),
+  lastPts(0),
+  hasLastPts(false),
+  framesSinceFullSearch(0)
+{
+  entries.reserve(MAX_TRACKS);
+}
+
+
+void MotionTracker::reset()
+{
+  entries.clear();
+  hasLastPts = false;
+}
+
+
+cv::Rect MotionTracker::predict(int64_t pts, const cv::Size& size, bool fullSearch)
+{
+  imageSize = size;
+  const double dt = hasLastPts ? (pts - lastPts) / 1000000.0 : 0.0;
+  lastPts = pts;
+  hasLastPts = true;
+  if (dt < 0 || dt > MAX_GAP)
+  {
+    entries.clear();
+  }
+
+  const cv::Rect image(0, 0, size.width, size.height);
+  cv::Rect region;
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    Entry& entry = entries[i];
+    if (dt > 0)
+    {
+      const double x = entry.ax.position;
+      const double y = entry.ay.position;
+      entry.ax.predict(dt);
+      entry.ay.predict(dt);
+      entry.track.boundingRect.x += cvRound(entry.ax.position - x);
+      entry.track.boundingRect.y += cvRound(entry.ay.position - y);
+    }
+
+    const cv::Rect entryGate = gate(entry) & image;
+    region = region.area() ? (region | entryGate) : entryGate;
+  }
+
+  framesSinceFullSearch += 1;
+  if (fullSearch || entries.empty() || framesSinceFullSearch >= FULL_SEARCH_INTERVAL || !region.area())
+  {
+    framesSinceFullSearch = 0;
+    return image;
+  }
+  return region;
+}
+
+
+double MotionTracker::distance(const Entry& entry, const Blob& blob) const
+{
+  const double dx = blob.centroidX - entry.ax.position;
+  const double dy = blob.centroidY - entry.ay.position;
+  return dx * dx / entry.ax.innovationVariance() + dy * dy / entry.ay.innovationVariance();
+}
+
+
+cv::Rect MotionTracker::gate(const Entry& entry) const
+{
+  // everything a blob centroid within the gate may cover
+  const double rx = std::sqrt(GATE * entry.ax.innovationVariance()) + entry.track.boundingRect.width / 2.0;
+  const double ry = std::sqrt(GATE * entry.ay.innovationVariance()) + entry.track.boundingRect.height / 2.0;
+  const int left = cvRound(entry.ax.position - rx);
+  const int top = cvRound(entry.ay.position - ry);
+  return cv::Rect(left, top, cvRound(entry.ax.position + rx) - left + 1, cvRound(entry.ay.position + ry) - top + 1);
+}
+
+
+void MotionTracker::update(const std::vector<Blob>& blobs, std::vector<Track>& confirmedTracks)
+{
+  const unsigned int blobCount = std::min<size_t>(blobs.size(), MAX_CANDIDATES);
+
+  // all pairs within the gate, the closest ones are associated first
+  Candidate candidates[MAX_TRACKS * MAX_CANDIDATES];
+  unsigned int candidateCount = 0;
+  for (unsigned int e = 0; e < entries.size(); ++e)
+  {
+    entries[e].track.updated = false;
+    for (unsigned int b = 0; b < blobCount; ++b)
+    {
+      const double d = distance(entries[e], blobs[b]);
+      if (d < GATE)
+      {
+        Candidate candidate = { d, e, b };
+        candidates[candidateCount++] = candidate;
+      }
+    }
+  }
+  std::sort(candidates, candidates + candidateCount, closerCandidate);
+
+  bool blobUsed[MAX_CANDIDATES] = { false };
+  for (unsigned int i = 0; i < candidateCount; ++i)
+  {
+    Entry& entry = entries[candidates[i].entry];
+    if (entry.track.updated || blobUsed[candidates[i].blob])
+    {
+      continue;
+    }
+
+    const Blob& blob = blobs[candidates[i].blob];
+    blobUsed[candidates[i].blob] = true;
+    entry.ax.update(blob.centroidX);
+    entry.ay.update(blob.centroidY);
+    entry.track.boundingRect = blob.boundingRect;
+    entry.track.updated = true;
+    entry.track.hits += 1;
+    entry.track.misses = 0;
+    entry.track.confirmed = entry.track.confirmed || entry.track.hits >= CONFIRM_HITS;
+  }
+
+  // tentative tracks must be seen in every frame, confirmed ones may be missed for a while
+  const cv::Rect image(0, 0, imageSize.width, imageSize.height);
+  size_t kept = 0;
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    Track& track = entries[i].track;
+    if (!track.updated)
+    {
+      track.misses += 1;
+    }
+    const bool lost = track.confirmed ? track.misses > MAX_MISSES : track.misses > 0;
+    const bool left = !image.contains(cv::Point(cvRound(entries[i].ax.position), cvRound(entries[i].ay.position)));
+    if (!lost && !left)
+    {
+      entries[kept++] = entries[i];
+    }
+  }
+  entries.resize(kept);
+
+  // blobs nobody claimed are new objects, the largest first
+  for (unsigned int b = 0; b < blobCount && entries.size() < MAX_TRACKS; ++b)
+  {
+    if (blobUsed[b])
+    {
+      continue;
+    }
+
+    Entry entry;
+    entry.ax.init(blobs[b].centroidX);
+    entry.ay.init(blobs[b].centroidY);
+    entry.track.id = nextId++;
+    entry.track.boundingRect = blobs[b].boundingRect;
+    entry.track.hits = 1;
+    entry.track.updated = true;
+    entries.push_back(entry);
+  }
+
+  confirmedTracks.clear();
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    Entry& entry = entries[i];
+    entry.track.x = entry.ax.position;
+    entry.track.y = entry.ay.position;
+    entry.track.vx = entry.ax.velocity;
+    entry.track.vy = entry.ay.velocity;
+    if (entry.track.confirmed)
+    {
+      confirmedTracks.push_back(entry.track);
+    }
+  }
+}
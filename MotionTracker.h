@@ -0,0 +1,156 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MOTION_TRACKER_H_INCLUDED
+#define MOTION_TRACKER_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <cstdint>
+#include <vector>
+
+#include "ConnectedComponents.h"
+
+/** An object followed from frame to frame. */
+struct Track
+{
+  /** What the PersonClassifier took the object for. */
+  enum Kind
+  {
+    KindUnknown,    ///< not classified (yet)
+    KindPerson,
+    KindOther       ///< leaves, a cat, car lights
+  };
+
+  Track()
+    : id(0), x(0), y(0), vx(0), vy(0), hits(0), misses(0), confirmed(false), updated(false), kind(KindUnknown)
+  { }
+
+
+  //stable as long as the object is followed, never reused
+  uint32_t id;
+  //filtered position in pixels and velocity in pixels per second
+  double x;
+  double y;
+  double vx;
+  double vy;
+  //of the last blob, moved along with the prediction while the object is not seen
+  cv::Rect boundingRect;
+  //frames the object was seen in, frames since it was seen last
+  uint32_t hits;
+  uint32_t misses;
+  //seen often enough to be taken for a real object
+  bool confirmed;
+  //seen in the current frame
+  bool updated;
+  //set by the PersonClassifier, KindUnknown without one
+  Kind kind;
+};
+
+
+/**
+   Follows several moving objects through the blobs of consecutive frames.
+
+   Every track has a constant velocity Kalman filter, x and y are filtered
+   independently. Each frame all tracks are predicted to the frame's time,
+   blobs are associated to the track whose prediction they are closest to,
+   measured in standard deviations of the prediction, and only within a
+   gate of a few standard deviations. Blobs left over start a new tentative
+   track, which is confirmed after CONFIRM_HITS frames in a row. Tracks
+   that are not seen for a while are dropped.
+
+   The gates also tell where blobs need to be searched at all: as long as
+   there are tracks, searchRegion() only covers their gates, the whole image
+   is searched every FULL_SEARCH_INTERVAL frames for new objects.
+
+   The tracker never allocates after construction.
+ */
+class MotionTracker
+{
+public:
+
+  //tracks followed at the same time
+  static const unsigned int MAX_TRACKS = 8;
+  //largest blobs considered for association per frame
+  static const unsigned int MAX_CANDIDATES = 16;
+  //a tentative track needs this many frames in a row to be confirmed
+  static const uint32_t CONFIRM_HITS = 3;
+  //a confirmed track is dropped after this many frames without a blob
+  static const uint32_t MAX_MISSES = 12;
+  //frames between searches of the whole image while there are tracks
+  static const uint32_t FULL_SEARCH_INTERVAL = 5;
+
+  MotionTracker();
+
+  /** Drops all tracks, e.g. after the source restarted. */
+  void reset();
+
+  /**
+     Predicts all tracks to time pts (microseconds) and returns the part of
+     an image of the given size in which blobs have to be searched, the
+     whole image if fullSearch is set. A forced full search restarts the
+     FULL_SEARCH_INTERVAL.
+   */
+  cv::Rect predict(int64_t pts, const cv::Size& size, bool fullSearch = false);
+
+  /**
+     Associates the blobs found in the search region (largest first, in
+     image coordinates) to the tracks and returns the confirmed tracks.
+   */
+  void update(const std::vector<Blob>& blobs, std::vector<Track>& confirmedTracks);
+
+private:
+
+  //position and velocity along one image axis with their covariance
+  struct Axis
+  {
+    void init(double position);
+    void predict(double dt);
+    void update(double measurement);
+    double innovationVariance() const;
+
+    double position;
+    double velocity;
+    double pp;
+    double pv;
+    double vv;
+  };
+
+  struct Entry
+  {
+    Track track;
+    Axis ax;
+    Axis ay;
+  };
+
+  //squared distance of the blob to the track's prediction in standard deviations
+  double distance(const Entry& entry, const Blob& blob) const;
+  cv::Rect gate(const Entry& entry) const;
+
+  std::vector<Entry> entries;
+  uint32_t nextId;
+  int64_t lastPts;
+  bool hasLastPts;
+  uint32_t framesSinceFullSearch;
+  cv::Size imageSize;
+};
+
+
+#endif
@@ -0,0 +1,473 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PacketRecorder.h"
+
+#include <algorithm>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+PacketRecorder::PacketRecorder(const std::string& fileName, const MotionSettings& settings_)
+  : packetsDropped(0),
+  settings(settings_),
+  queue(QUEUE_CAPACITY),
+  triggered(false),
+  firstMotionUs(0),
+  lastMotionUs(0),
+  parameters(NULL),
+  timeBaseNum(1),
+  timeBaseDen(AV_TIME_BASE),
+  output(NULL),
+  outputStream(NULL),
+  boxes(NULL),
+  segmentOffset(0),
+  segmentStartUs(0),
+  eventIndex(fileName, ".mkv"),
+  preRollBytes(0),
+  preRollMaxBytes((size_t)settings_.preRollMemoryMb * 1024 * 1024),
+  packetsWritten(0),
+  writeErrors(0)
+{
+  thread = std::thread(&PacketRecorder::run, this);
+}
+
+
+PacketRecorder::~PacketRecorder()
+{
+  close();
+}
+
+
+int64_t PacketRecorder::packetTimeUs(const AVPacket* packet) const
+{
+  return toMicroseconds(packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts);
+}
+
+
+void PacketRecorder::setStream(const AVCodecParameters* parameters_, int timeBaseNum_, int timeBaseDen_)
+{
+  Item item;
+  item.type = Item::StreamStart;
+  item.packet = NULL;
+  item.parameters = avcodec_parameters_alloc();
+  avcodec_parameters_copy(item.parameters, parameters_);
+  item.timeBaseNum = timeBaseNum_;
+  item.timeBaseDen = timeBaseDen_;
+  // rare enough to wait for the writer, the packets that follow depend on it
+  if (!queue.push(item))
+  {
+    avcodec_parameters_free(&item.parameters);
+  }
+}
+
+
+void PacketRecorder::endStream()
+{
+  Item item;
+  item.type = Item::StreamEnd;
+  item.packet = NULL;
+  item.parameters = NULL;
+  queue.push(item);
+}
+
+
+void PacketRecorder::writePacket(const AVPacket* packet)
+{
+  if (packet->dts == AV_NOPTS_VALUE && packet->pts == AV_NOPTS_VALUE)
+  {
+    return;
+  }
+
+  Item item;
+  item.type = Item::Packet;
+  item.packet = av_packet_clone(packet);
+  item.parameters = NULL;
+  if (!queue.tryPush(item))
+  {
+    packetsDropped += 1;
+    av_packet_free(&item.packet);
+  }
+}
+
+
+void PacketRecorder::motion(int64_t pts, bool objectDetected, const cv::Rect& objectBoundingRectangle)
+{
+  if (!objectDetected)
+  {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(motionMutex);
+  if (!triggered)
+  {
+    firstMotionUs = pts;
+  }
+  triggered = true;
+  lastMotionUs = pts;
+
+  if (newBoxes.size() < MAX_PENDING_BOXES)
+  {
+    Box box = { pts, objectBoundingRectangle };
+    newBoxes.push_back(box);
+  }
+}
+
+
+void PacketRecorder::close()
+{
+  // the writer drains the queue before it returns
+  queue.close();
+  if (thread.joinable())
+  {
+    thread.join();
+    if (packetsDropped > 0)
+    {
+      printf("recorder: %llu packets dropped\n", (unsigned long long)packetsDropped);
+    }
+  }
+}
+
+
+void PacketRecorder::run()
+{
+  Item item;
+  while (queue.pop(item))
+  {
+    switch (item.type)
+    {
+    case Item::Packet:
+      if (parameters)
+      {
+        handlePacket(item.packet);
+      }
+      av_packet_free(&item.packet);
+      break;
+
+    case Item::StreamStart:
+      // a reopened stream may come with different parameters, it always starts a new segment
+      closeSegment();
+      clearPreRoll();
+      resetTrigger();
+      avcodec_parameters_free(&parameters);
+      parameters = item.parameters;
+      timeBaseNum = item.timeBaseNum;
+      timeBaseDen = item.timeBaseDen;
+      break;
+
+    case Item::StreamEnd:
+      closeSegment();
+      clearPreRoll();
+      resetTrigger();
+      break;
+    }
+  }
+
+  closeSegment();
+  clearPreRoll();
+  avcodec_parameters_free(&parameters);
+}
+
+
+void PacketRecorder::resetTrigger()
+{
+  std::lock_guard<std::mutex> lock(motionMutex);
+  triggered = false;
+  newBoxes.clear();
+}
+
+
+void PacketRecorder::handlePacket(AVPacket* packet)
+{
+  bool isTriggered;
+  int64_t firstUs;
+  int64_t lastUs;
+  {
+    std::lock_guard<std::mutex> lock(motionMutex);
+    isTriggered = triggered;
+    firstUs = firstMotionUs;
+    lastUs = lastMotionUs;
+    pendingBoxes.insert(pendingBoxes.end(), newBoxes.begin(), newBoxes.end());
+    newBoxes.clear();
+  }
+
+  if (output && (!isTriggered || packetTimeUs(packet) > lastUs + settings.postTriggerMs * 1000LL))
+  {
+    closeSegment();
+    isTriggered = false;
+
+    std::lock_guard<std::mutex> lock(motionMutex);
+    // unless motion() saw something new meanwhile
+    if (lastMotionUs == lastUs)
+    {
+      triggered = false;
+    }
+  }
+
+  if (output)
+  {
+    writeToSegment(packet);
+    writeBoxes();
+    return;
+  }
+
+  // between events the packets wait in the pre-roll, so an event file can
+  // start up to MotionSettings::preTriggerMs before the motion was seen
+  preRoll.push_back(av_packet_clone(packet));
+  preRollBytes += packet->size;
+  trimPreRoll();
+
+  if (isTriggered)
+  {
+    startSegment(firstUs);
+  }
+  if (pendingBoxes.size() > MAX_PENDING_BOXES)
+  {
+    pendingBoxes.erase(pendingBoxes.begin(), pendingBoxes.end() - MAX_PENDING_BOXES);
+  }
+}
+
+
+void PacketRecorder::trimPreRoll()
+{
+  const int64_t newestUs = packetTimeUs(preRoll.back());
+  const int64_t windowUs = (settings.preTriggerMs + PRE_ROLL_SLACK_MS) * 1000LL;
+
+  // the pre-roll always starts with the key frame that starts the window, a
+  // key frame later than that lets everything in front of it go
+  for (size_t i = 1; i < preRoll.size(); ++i)
+  {
+    if (!(preRoll[i]->flags & AV_PKT_FLAG_KEY))
+    {
+      continue;
+    }
+    if (packetTimeUs(preRoll[i]) > newestUs - windowUs)
+    {
+      break;
+    }
+    dropPreRollFront(i);
+    i = 0;
+  }
+
+  // the memory limit wins over the window, whole groups of pictures are dropped
+  while (preRollBytes > preRollMaxBytes && preRoll.size() > 1)
+  {
+    size_t nextKey = 1;
+    while (nextKey < preRoll.size() && !(preRoll[nextKey]->flags & AV_PKT_FLAG_KEY))
+    {
+      ++nextKey;
+    }
+    dropPreRollFront(nextKey);
+  }
+}
+
+
+void PacketRecorder::dropPreRollFront(size_t count)
+{
+  for (size_t i = 0; i < count && !preRoll.empty(); ++i)
+  {
+    AVPacket* packet = preRoll.front();
+    preRollBytes -= packet->size;
+    av_packet_free(&packet);
+    preRoll.pop_front();
+  }
+}
+
+
+void PacketRecorder::clearPreRoll()
+{
+  dropPreRollFront(preRoll.size());
+}
+
+
+void PacketRecorder::startSegment(int64_t firstMotionUs_)
+{
+  // a segment has to start with a key frame to be decodable on its own,
+  // preferably the last one at least preTriggerMs before the motion
+  const int64_t wantedStartUs = firstMotionUs_ - settings.preTriggerMs * 1000LL;
+  size_t start = preRoll.size();
+  for (size_t i = 0; i < preRoll.size(); ++i)
+  {
+    if (!(preRoll[i]->flags & AV_PKT_FLAG_KEY))
+    {
+      continue;
+    }
+    if (start == preRoll.size() || packetTimeUs(preRoll[i]) <= wantedStartUs)
+    {
+      start = i;
+    }
+    if (packetTimeUs(preRoll[i]) > wantedStartUs)
+    {
+      break;
+    }
+  }
+  if (start == preRoll.size())
+  {
+    // no key frame yet, keep collecting
+    return;
+  }
+
+  const AVPacket* first = preRoll[start];
+  if (!openSegment(first->dts != AV_NOPTS_VALUE ? first->dts : first->pts))
+  {
+    resetTrigger();
+    return;
+  }
+
+  for (size_t i = start; i < preRoll.size(); ++i)
+  {
+    writeToSegment(preRoll[i]);
+  }
+  clearPreRoll();
+  writeBoxes();
+}
+
+
+void PacketRecorder::writeToSegment(const AVPacket* packet)
+{
+  AVPacket* copy = av_packet_clone(packet);
+  copy->stream_index = 0;
+  copy->pos = -1;
+  if (copy->pts != AV_NOPTS_VALUE)
+  {
+    copy->pts -= segmentOffset;
+  }
+  if (copy->dts != AV_NOPTS_VALUE)
+  {
+    copy->dts -= segmentOffset;
+  }
+  const AVRational inputTimeBase = { timeBaseNum, timeBaseDen };
+  av_packet_rescale_ts(copy, inputTimeBase, outputStream->time_base);
+
+  if (av_write_frame(output, copy) < 0)
+  {
+    writeErrors += 1;
+  }
+  else
+  {
+    packetsWritten += 1;
+    eventIndex.addFrame(packetTimeUs(packet));
+  }
+  av_packet_free(&copy);
+}
+
+
+void PacketRecorder::writeBoxes()
+{
+  if (boxes)
+  {
+    for (size_t i = 0; i < pendingBoxes.size(); ++i)
+    {
+      const Box& box = pendingBoxes[i];
+      if (box.pts >= segmentStartUs)
+      {
+        eventIndex.addMotion(box.pts, box.rectangle);
+        fprintf(boxes, "%.1f %d %d %d %d\n", (box.pts - segmentStartUs) / 1000.0,
+                box.rectangle.x, box.rectangle.y, box.rectangle.width, box.rectangle.height);
+      }
+    }
+  }
+  pendingBoxes.clear();
+}
+
+
+bool PacketRecorder::openSegment(int64_t startTimestamp)
+{
+  const std::string fileName = eventIndex.beginEvent(toMicroseconds(startTimestamp));
+
+  if (avformat_alloc_output_context2(&output, NULL, NULL, fileName.c_str()) < 0 || !output)
+  {
+    printf("recorder: no container format for '%s'\n", fileName.c_str());
+    output = NULL;
+    eventIndex.abortEvent();
+    return false;
+  }
+
+  outputStream = avformat_new_stream(output, NULL);
+  avcodec_parameters_copy(outputStream->codecpar, parameters);
+  // the tag of the input container may not be valid in the output container
+  outputStream->codecpar->codec_tag = 0;
+  outputStream->time_base.num = timeBaseNum;
+  outputStream->time_base.den = timeBaseDen;
+
+  if (avio_open(&output->pb, fileName.c_str(), AVIO_FLAG_WRITE) < 0 ||
+      avformat_write_header(output, NULL) < 0)
+  {
+    printf("recorder: could not open '%s'\n", fileName.c_str());
+    if (output->pb)
+    {
+      avio_closep(&output->pb);
+    }
+    avformat_free_context(output);
+    output = NULL;
+    outputStream = NULL;
+    eventIndex.abortEvent();
+    return false;
+  }
+
+  segmentOffset = startTimestamp;
+  segmentStartUs = toMicroseconds(startTimestamp);
+
+  boxes = fopen((fileName + ".boxes").c_str(), "w");
+  if (boxes)
+  {
+    fprintf(boxes, "# ms since segment start, x y width height in detection coordinates\n");
+  }
+
+  printf("recorder: started '%s'\n", fileName.c_str());
+  return true;
+}
+
+
+void PacketRecorder::closeSegment()
+{
+  if (!output)
+  {
+    return;
+  }
+
+  av_write_trailer(output);
+  avio_closep(&output->pb);
+  avformat_free_context(output);
+  output = NULL;
+  outputStream = NULL;
+
+  if (boxes)
+  {
+    fclose(boxes);
+    boxes = NULL;
+  }
+  eventIndex.endEvent();
+
+  printf("recorder: closed segment, %llu packets written, %llu write errors, %llu dropped\n",
+         (unsigned long long)packetsWritten, (unsigned long long)writeErrors,
+         (unsigned long long)packetsDropped);
+}
+
+
+int64_t PacketRecorder::toMicroseconds(int64_t timestamp) const
+{
+  const AVRational inputTimeBase = { timeBaseNum, timeBaseDen };
+  return av_rescale_q(timestamp, inputTimeBase, AV_TIME_BASE_Q);
+}
@@ -0,0 +1,183 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PACKET_RECORDER_H_INCLUDED
+#define PACKET_RECORDER_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "EventIndex.h"
+#include "MotionSettings.h"
+
+struct AVCodecParameters;
+struct AVFormatContext;
+struct AVPacket;
+struct AVStream;
+
+/**
+   Records motion events by remuxing the camera's compressed packets into
+   one file per event, without decoding or encoding a single picture.
+
+   The capture engine hands over every video packet with writePacket(), the
+   detection reports each processed frame with motion(). Between events the
+   packets of the last MotionSettings::preTriggerMs wait in a pre-roll
+   limited to MotionSettings::preRollMemoryMb. When motion is seen a segment
+   is opened at the key frame that starts the pre-roll window, the pre-roll is
+   written and the segment continues until no motion was seen for
+   MotionSettings::postTriggerMs. The container is chosen from the
+   extension of the file name, e.g. capture.mkv records capture-0001.mkv,
+   capture-0002.mkv, ... and lists them in capture.index.jsonl, see
+   EventIndex.
+
+   Next to every segment a text file with the suffix .boxes lists the
+   bounding boxes of the detected object, so the annotations do not have to
+   be burned into the pictures.
+
+   Muxing and all file access happen on a writer thread of its own, fed by
+   a bounded queue. If the disk cannot keep up, packets are dropped and
+   counted instead of blocking the capture thread. close() writes what is
+   still queued and finishes the current segment.
+
+   All methods may be called from different threads.
+ */
+class PacketRecorder
+{
+public:
+
+  PacketRecorder(const std::string& fileName, const MotionSettings& settings);
+  virtual ~PacketRecorder();
+
+  /** Called by the capture engine whenever it (re)opened the stream. */
+  void setStream(const AVCodecParameters* parameters, int timeBaseNum, int timeBaseDen);
+
+  /** Called by the capture engine when the stream ended, closes the current segment. */
+  void endStream();
+
+  /** Called by the capture engine for every compressed packet of the video stream. */
+  void writePacket(const AVPacket* packet);
+
+  /** Result of the detection for the frame with pts (microseconds, like FrameRing::Slot::pts). */
+  void motion(int64_t pts, bool objectDetected, const cv::Rect& objectBoundingRectangle);
+
+  void close();
+
+  //packets dropped because the writer thread fell behind
+  std::atomic<uint64_t> packetsDropped;
+
+private:
+
+  PacketRecorder(const PacketRecorder&);
+  PacketRecorder& operator=(const PacketRecorder&);
+
+  //extra time kept in the pre-roll, detection reports motion this much later
+  static const int PRE_ROLL_SLACK_MS = 1000;
+  //packets that may wait for the writer thread, about ten seconds of video
+  static const unsigned int QUEUE_CAPACITY = 256;
+  //boxes kept while no segment is open
+  static const unsigned int MAX_PENDING_BOXES = 256;
+
+  struct Item
+  {
+    enum Type
+    {
+      Packet,
+      StreamStart,
+      StreamEnd
+    };
+
+    Type type;
+    AVPacket* packet;
+    AVCodecParameters* parameters;
+    int timeBaseNum;
+    int timeBaseDen;
+  };
+
+  struct Box
+  {
+    int64_t pts;
+    cv::Rect rectangle;
+  };
+
+  void run();
+  void handlePacket(AVPacket* packet);
+  void resetTrigger();
+
+  void trimPreRoll();
+  void dropPreRollFront(size_t count);
+  void clearPreRoll();
+  void startSegment(int64_t firstMotionUs);
+  bool openSegment(int64_t startPts);
+  void writeToSegment(const AVPacket* packet);
+  void writeBoxes();
+  void closeSegment();
+  int64_t toMicroseconds(int64_t timestamp) const;
+  int64_t packetTimeUs(const AVPacket* packet) const;
+
+  const MotionSettings settings;
+
+  BoundedQueue<Item> queue;
+  std::thread thread;
+
+  //shared with motion(), everything below it belongs to the writer thread
+  std::mutex motionMutex;
+  //pts of the first and the last frame with motion, valid if triggered
+  bool triggered;
+  int64_t firstMotionUs;
+  int64_t lastMotionUs;
+  std::vector<Box> newBoxes;
+
+  //parameters of the input stream, NULL until the stream started
+  AVCodecParameters* parameters;
+  int timeBaseNum;
+  int timeBaseDen;
+
+  //the segment being written, NULL between events
+  AVFormatContext* output;
+  AVStream* outputStream;
+  FILE* boxes;
+  //first timestamp of the segment in the input time base, subtracted from all packets
+  int64_t segmentOffset;
+  int64_t segmentStartUs;
+  EventIndex eventIndex;
+
+  //boxes taken from newBoxes that wait for their segment
+  std::vector<Box> pendingBoxes;
+
+  //packets received since the key frame starting the pre-roll window
+  std::deque<AVPacket*> preRoll;
+  size_t preRollBytes;
+  const size_t preRollMaxBytes;
+
+  uint64_t packetsWritten;
+  uint64_t writeErrors;
+};
+
+
+#endif
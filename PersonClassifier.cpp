@@ -0,0 +1,208 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PersonClassifier.h"
+
+#include <algorithm>
+
+const unsigned int PersonClassifier::QUEUE_CAPACITY;
+const int64_t PersonClassifier::INTERVAL_US;
+const uint32_t PersonClassifier::REJECT_COUNT;
+
+namespace
+{
+
+//size of the default people detector's window, a person fills about 3/4 of its height
+const int WINDOW_WIDTH = 64;
+const int WINDOW_HEIGHT = 128;
+
+}
+
+
+PersonClassifier::PersonClassifier()
+  : requests(QUEUE_CAPACITY),
+  freeRequests(QUEUE_CAPACITY),
+  pendingRequests(QUEUE_CAPACITY)
+{
+  hog.setSVMDetector(cv::HOGDescriptor::getDefaultPeopleDetector());
+  results.reserve(2 * MotionTracker::MAX_TRACKS);
+  for (size_t i = 0; i < requests.size(); ++i)
+  {
+    requests[i].window.create(WINDOW_HEIGHT, WINDOW_WIDTH, CV_8UC1);
+    freeRequests.tryPush(&requests[i]);
+  }
+  thread = std::thread(&PersonClassifier::run, this);
+}
+
+
+PersonClassifier::~PersonClassifier()
+{
+  close();
+}
+
+
+void PersonClassifier::close()
+{
+  freeRequests.close();
+  pendingRequests.close();
+  if (thread.joinable())
+  {
+    thread.join();
+  }
+}
+
+
+PersonClassifier::Result* PersonClassifier::find(uint32_t trackId)
+{
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    if (results[i].trackId == trackId)
+    {
+      return &results[i];
+    }
+  }
+  return NULL;
+}
+
+
+void PersonClassifier::submit(const cv::Mat& image, const std::vector<Track>& tracks, int64_t pts)
+{
+  for (size_t i = 0; i < tracks.size(); ++i)
+  {
+    const Track& track = tracks[i];
+    if (!track.updated)
+    {
+      //the box only moved along with the prediction, there may be nothing in it
+      continue;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(resultMutex);
+      Result* result = find(track.id);
+      if (result && pts - result->lastSubmitPts < INTERVAL_US)
+      {
+        continue;
+      }
+      if (!result)
+      {
+        if (results.size() == results.capacity())
+        {
+          //more tracks than ever followed at once, apply() has not pruned yet
+          continue;
+        }
+        Result added = { track.id, 0, 0, 0 };
+        results.push_back(added);
+        result = &results.back();
+      }
+      result->lastSubmitPts = pts;
+    }
+
+    Request* request;
+    if (!freeRequests.tryPop(request))
+    {
+      //the worker is busy, this track is tried again with the next frame
+      std::lock_guard<std::mutex> lock(resultMutex);
+      find(track.id)->lastSubmitPts = pts - INTERVAL_US;
+      return;
+    }
+
+    //a window of the detector's proportions around the box, with the margin the detector was trained with
+    const cv::Rect& box = track.boundingRect;
+    const int height = std::max(box.height, box.width * WINDOW_HEIGHT / WINDOW_WIDTH) * 4 / 3;
+    const int width = height * WINDOW_WIDTH / WINDOW_HEIGHT;
+    const cv::Rect crop = cv::Rect(box.x + box.width / 2 - width / 2, box.y + box.height / 2 - height / 2,
+                                   width, height) & cv::Rect(0, 0, image.cols, image.rows);
+    if (crop.width < 8 || crop.height < 16)
+    {
+      freeRequests.tryPush(request);
+      continue;
+    }
+    request->trackId = track.id;
+    cv::resize(cv::Mat(image, crop), request->window, request->window.size(), 0, 0, cv::INTER_LINEAR);
+    pendingRequests.tryPush(request);
+  }
+}
+
+
+void PersonClassifier::apply(std::vector<Track>& tracks)
+{
+  std::lock_guard<std::mutex> lock(resultMutex);
+  size_t kept = 0;
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    bool present = false;
+    for (size_t t = 0; t < tracks.size(); ++t)
+    {
+      if (tracks[t].id != results[i].trackId)
+      {
+        continue;
+      }
+      present = true;
+      const Result& result = results[i];
+      if (result.positives > 0)
+      {
+        tracks[t].kind = Track::KindPerson;
+      }
+      else if (result.negatives >= REJECT_COUNT)
+      {
+        tracks[t].kind = Track::KindOther;
+      }
+    }
+    if (present)
+    {
+      results[kept++] = results[i];
+    }
+  }
+  results.resize(kept);
+}
+
+
+void PersonClassifier::reset()
+{
+  std::lock_guard<std::mutex> lock(resultMutex);
+  results.clear();
+}
+
+
+void PersonClassifier::run()
+{
+  std::vector<cv::Point> found;
+  Request* request;
+  while (pendingRequests.pop(request))
+  {
+    //the window is the detector's size, there is exactly one position to test
+    found.clear();
+    hog.detect(request->window, found);
+    {
+      std::lock_guard<std::mutex> lock(resultMutex);
+      Result* result = find(request->trackId);
+      if (result && !found.empty())
+      {
+        result->positives += 1;
+      }
+      else if (result)
+      {
+        result->negatives += 1;
+      }
+    }
+    freeRequests.tryPush(request);
+  }
+}
@@ -0,0 +1,112 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PERSON_CLASSIFIER_H_INCLUDED
+#define PERSON_CLASSIFIER_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <opencv2/objdetect/objdetect.hpp>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "MotionTracker.h"
+
+/**
+   Tells people from leaves, cats and car lights by running OpenCV's HOG
+   people detector on the tracks, on a thread of its own.
+
+   The blob stage hands the tracks of a frame to submit(), which cuts them
+   out of the gray image, scales them to the detector's window and queues
+   them. A track is classified again every INTERVAL_US at most, and a crop
+   that finds the queue full waits for a later frame, so submit() never
+   blocks and the cost grows with the number of tracks, not the image size.
+   apply() later copies the results gathered so far into the tracks, see
+   Track::kind. A track counts as something else than a person only after
+   REJECT_COUNT negative results without a positive one, a single missed
+   person does not make the eyes ignore them.
+
+   submit(), apply() and reset() must be called from one thread.
+ */
+class PersonClassifier
+{
+public:
+
+  //crops waiting for the worker
+  static const unsigned int QUEUE_CAPACITY = 4;
+  //a track is classified again after this long
+  static const int64_t INTERVAL_US = 500000;
+  //negative results after which a track is no person
+  static const uint32_t REJECT_COUNT = 3;
+
+  PersonClassifier();
+  virtual ~PersonClassifier();
+
+  /** Queues the tracks due for classification, cut out of image. Never blocks. */
+  void submit(const cv::Mat& image, const std::vector<Track>& tracks, int64_t pts);
+
+  /** Sets Track::kind from the results so far, forgets tracks that are gone. */
+  void apply(std::vector<Track>& tracks);
+
+  /** Forgets all results, e.g. after the tracker was reset. */
+  void reset();
+
+  /** Classifies what is queued, then stops the worker. */
+  void close();
+
+private:
+
+  PersonClassifier(const PersonClassifier&);
+  PersonClassifier& operator=(const PersonClassifier&);
+
+  struct Request
+  {
+    uint32_t trackId;
+    //crop scaled to the detector window
+    cv::Mat window;
+  };
+
+  struct Result
+  {
+    uint32_t trackId;
+    int64_t lastSubmitPts;
+    uint32_t positives;
+    uint32_t negatives;
+  };
+
+  void run();
+  Result* find(uint32_t trackId);
+
+  cv::HOGDescriptor hog;
+  std::vector<Request> requests;
+  BoundedQueue<Request*> freeRequests;
+  BoundedQueue<Request*> pendingRequests;
+  std::thread thread;
+
+  //shared with the worker
+  std::mutex resultMutex;
+  std::vector<Result> results;
+};
+
+
+#endif
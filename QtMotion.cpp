@@ -21,9 +21,14 @@
 
 #include "QtMotion.h"
 
+#include "EyeMapping.h"
+
 int unused;
 
-QtMotion::QtMotion(const QString& source_, const QString& dest_)
+//the eyes look where the object will be this much later, so they do not lag behind walkers
+const double GAZE_LEAD_S = 0.3;
+
+QtMotion::QtMotion(const QString& source_, const QString& dest_, const MotionSettings& settings)
 {
   groupAddress = QHostAddress("239.255.43.21");
 
@@ -35,13 +40,17 @@ QtMotion::QtMotion(const QString& source_, const QString& dest_)
   connect(&switchToSimulationTimer, SIGNAL(timeout()), this, SLOT(switchToSimulation()));
 
   connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), this, SLOT(close()));
-  connect(&mt, SIGNAL(objectDetected(int,int)), this, SLOT(objectDetected(int,int)));
+  connect(&mt, SIGNAL(objectDetected(int,int,double,double)), this, SLOT(objectDetected(int,int,double,double)));
 
   const QDateTime now = QDateTime::currentDateTime();
   const QString timestamp = now.toString(QLatin1String("yyyyMMdd-hhmmss"));
   const QString outFilename = dest_.arg(timestamp);
 
-  mt.open(source_, outFilename);
+  if (!mt.open(source_, outFilename, settings))
+  {
+    //the eyes keep moving by themselves meanwhile
+    qDebug("cannot start '%s' yet, retrying", qPrintable(source_));
+  }
 
   simulationTimer.start();
 }
@@ -77,19 +86,14 @@ void QtMotion::simulationStep()
 }
 
 
-void QtMotion::objectDetected(int x, int y)
+void QtMotion::objectDetected(int x, int y, double vx, double vy)
 {
   es.stopEyeMovement();
   switchToSimulationTimer.start();   // restarts timer
 
-  // transform from 320x240 -> 1280x1024
-  const double x_1280 = x * 4.0;
-  const double y_1024 = (y + 8.0) * 4.0;
-
-
-  //transform to global coordinate system x: [-3..3] [m], y [0..12] [m]
-  const double xEye = -2.10554+x_1280 * (0.00362959 -2.89324E-7 * x_1280-2.24893E-6 * y_1024)+0.00145656 * y_1024;
-  const double yEye = -0.383554+x_1280 * (0.000500975 -3.04759E-7 * x_1280+1.12333E-7 * y_1024)+0.00225704 * y_1024;
+  double xEye;
+  double yEye;
+  cameraToEye(x + vx * GAZE_LEAD_S, y + vy * GAZE_LEAD_S, xEye, yEye);
 
 
   es.state.lookPosLeft = QPointF(between(-1.0, xEye, 1.0), between(-1.0, yEye, 1.0));
@@ -36,7 +36,7 @@ class QtMotion : public QObject
 
 public:
 
-  QtMotion(const QString& source_, const QString& dest_);
+  QtMotion(const QString& source_, const QString& dest_, const MotionSettings& settings);
   virtual ~QtMotion();
 
 public slots:
@@ -45,7 +45,7 @@ public slots:
   void switchToSimulation();
 
   void close();
-  void objectDetected(int x, int y);
+  void objectDetected(int x, int y, double vx, double vy);
 
 private:
 
@@ -29,93 +29,18 @@
 #include "QtMotionTracking.h"
 
 #include <stdint.h>
-#include <inttypes.h>
 
 using namespace std;
 using namespace cv;
 
-uint8_t* videoBuffer = 0;
-unsigned int videoBufferSize = 0;
-
-void QtMotionTracking::cbVideoPrerender(void* p_video_data, uint8_t** pp_pixel_buffer, int size)
-{
-  ((QtMotionTracking*)p_video_data)->videoPrerender(pp_pixel_buffer, size);
-}
-
-
-void QtMotionTracking::videoPrerender(uint8_t** pp_pixel_buffer, int size)
-{
-  nextImage = std::make_shared<cv::Mat>();
-  nextImage->create(cv::Size(320, 240), CV_8UC3);
-  *pp_pixel_buffer = nextImage->ptr(0, 0);
-}
-
-
-void QtMotionTracking::cbVideoPostrender(void* p_video_data, uint8_t* p_pixel_buffer, int width, int height,
-                                         int pixel_pitch, int size, int64_t pts)
-{
-  ((QtMotionTracking*)p_video_data)->videoPostRender(p_pixel_buffer, width, height, pixel_pitch, size, pts);
-}
-
-
-void QtMotionTracking::videoPostRender(uint8_t* p_pixel_buffer, int width, int height, int pixel_pitch, int size,
-                                       int64_t pts)
-{
-  if (nextImage)
-  {
-    imageQueue.push(nextImage);
-    nextImage.reset();
-    emit triggerStep();
-  }
-}
-
-
-void QtMotionTracking::handleEventMember(const libvlc_event_t* pEvt)
-{
-  libvlc_time_t time;
-  switch (pEvt->type)
-  {
-    case libvlc_MediaPlayerTimeChanged:
-      time = libvlc_media_player_get_time(vlcMediaMplayer.get());
-      //printf("MediaPlayerTimeChanged %lld ms\n", (long long)time);
-      break;
-
-    case libvlc_MediaPlayerPlaying:
-      opening = false;
-      printf("%s\n", libvlc_event_type_name(pEvt->type));
-      break;
-
-    case libvlc_MediaPlayerStopped:
-    case libvlc_MediaPlayerEndReached:
-
-      printf("%s\n", libvlc_event_type_name(pEvt->type));
-      emit triggerStep();
-      break;
-
-    case libvlc_MediaPlayerPositionChanged:
-      break;
-
-    case libvlc_MediaStateChanged:
-      printf("%s\n", libvlc_event_type_name(pEvt->type));
-      printf("state %d\n", libvlc_media_get_state       (       vlcMedia.get()  )       );
-      emit triggerStep();
-      break;
-
-    default:
-      printf("%s\n", libvlc_event_type_name(pEvt->type));
-  }
-}
+const unsigned int QtMotionTracking::FRAME_RING_CAPACITY;
 
 
 QtMotionTracking::QtMotionTracking()
   : benchmarkFilter(100)
 {
-  objectBoundingRectangle = Rect(0, 0, 0, 0);
   objectDetectedCount = 0;
   smallSize = Size(320, 240);
-  debugMode = false;
-  hasLastImage = false;
-  frames = 0;
 
   reopenTimer.setInterval(5000);
   connect(&reopenTimer, SIGNAL(timeout()), this, SLOT(step()));
@@ -130,217 +55,122 @@ QtMotionTracking::~QtMotionTracking()
 { }
 
 
-bool QtMotionTracking::open(const QString& source_, const QString& dest)
+bool QtMotionTracking::open(const QString& source_, const QString& dest, const MotionSettings& settings_)
 {
   source = source_;
+  settings = settings_;
 
-  oVideoWriter  = VideoWriter(qPrintable(dest), CV_FOURCC('X', 'V', 'I', 'D'), 20, smallSize, true);
-  if (!oVideoWriter.isOpened())
+  if (settings.captureFormat == MotionSettings::CaptureLuma)
   {
-    qDebug("Error opening video writer.");
-    return false;
-
+    //I420: full resolution luma plane followed by the two quarter resolution chroma planes
+    frameRing = std::make_shared<FrameRing>(FRAME_RING_CAPACITY, Size(smallSize.width, smallSize.height * 3 / 2),
+                                            CV_8UC1, FrameRing::DropOldest);
   }
-
-
-  // VLC options
-  char smem_options[1000];
-
-  // RV24
-  sprintf(smem_options,
-          "#transcode{vcodec=RV24}:smem{"
-          "video-prerender-callback=%" PRId64 ","
-          "video-postrender-callback=%" PRId64 ","
-          "video-data=%" PRId64 ","
-          "no-time-sync},",
-          (long long int)(intptr_t)(void*)&cbVideoPrerender,
-          (long long int)(intptr_t)(void*)&cbVideoPostrender,
-          (long long int)(intptr_t)(void*)this
-         );
-
-  const char* const vlc_args[] = {
-    "-I", "dummy",                        // Don't use any interface
-    "--ignore-config",                    // Don't use VLC's config
-    "--no-xlib",
-    "--no-audio",
-    "--aout=none",
-    "--extraintf=logger",                 // Log anything
-//    "--verbose=2",                        // Be verbose
-    "--sout", smem_options                // Stream to memory
-  };
-
-  // Launch VLC
-  vlcInstance =
-    std::shared_ptr<libvlc_instance_t>(libvlc_new(sizeof(vlc_args) / sizeof(vlc_args[0]), vlc_args),
-                                       [=](libvlc_instance_t* ptr)
+  else
   {
-    libvlc_release(ptr);
-  });
+    frameRing = std::make_shared<FrameRing>(FRAME_RING_CAPACITY, smallSize, CV_8UC3, FrameRing::DropOldest);
+  }
 
-  vlcMedia =
-    std::shared_ptr<libvlc_media_t>(libvlc_media_new_location(vlcInstance.get(), qPrintable(source)),
-                                    [=](libvlc_media_t* ptr)
+  pipeline = std::make_shared<DetectionPipeline>(settings, smallSize, frameRing);
+  std::shared_ptr<DetectionPipeline> notifiedPipeline = pipeline;
+  frameSource = FrameSource::create(source.toStdString(), smallSize, settings, frameRing, [notifiedPipeline]()
   {
-    libvlc_media_release(ptr);
+    notifiedPipeline->notifyFrame();
   });
-
-  vlcMediaMplayer =
-    std::shared_ptr<libvlc_media_player_t>(libvlc_media_player_new_from_media(vlcMedia.get()),
-                                           [=](libvlc_media_player_t* ptr)
+  //a dead stream is reopened right away instead of on the next reopenTimer tick
+  frameSource->setEndCallback([this]()
   {
-    libvlc_media_player_release(ptr);
+    emit triggerStep();
   });
 
-  libvlc_event_manager_t* eventManager = libvlc_media_player_event_manager(vlcMediaMplayer.get());
-
-  auto handleEvent([](const libvlc_event_t* pEvt, void* pUserData)
+  if (settings.recordMode == MotionSettings::RecordRemux)
+  {
+    packetRecorder = std::make_shared<PacketRecorder>(dest.toStdString(), settings);
+    if (!frameSource->setPacketRecorder(packetRecorder))
     {
-                   ((QtMotionTracking*)pUserData)->handleEventMember(pEvt);
-    });
-  libvlc_event_attach(eventManager, libvlc_MediaPlayerTimeChanged, handleEvent, this);
-  libvlc_event_attach(eventManager, libvlc_MediaPlayerEndReached, handleEvent, this);
-  libvlc_event_attach(eventManager, libvlc_MediaPlayerStopped, handleEvent, this);
-  libvlc_event_attach(eventManager, libvlc_MediaPlayerPlaying, handleEvent, this);
-  libvlc_event_attach(eventManager, libvlc_MediaPlayerPositionChanged, handleEvent, this);
+      qDebug("Recording the compressed stream needs --engine=libav, encoding the frames instead.");
+      packetRecorder.reset();
+    }
+  }
+  if (!packetRecorder)
+  {
+    frameRecorder = std::make_shared<FrameRecorder>(dest.toStdString(), smallSize, settings);
+  }
 
-  libvlc_event_manager_t* eventManager2 = libvlc_media_event_manager(vlcMedia.get());
-  libvlc_event_attach(eventManager2, libvlc_MediaStateChanged, handleEvent, this);
+  //the stages read the recording members, so they start once those are set up
+  pipeline->start([this](DetectionFrame& frame)
+  {
+    publish(frame);
+  }, [this](const DetectionFrame& frame)
+  {
+    return wantsRecording(frame);
+  }, [this](DetectionFrame& frame)
+  {
+    record(frame);
+  });
 
+  qDebug("opening '%s'", qPrintable(source));
+  const bool started = frameSource->start();
+  //also retries a source that could not be started yet
   reopenTimer.start();
-  triggerStep();
+  return started;
 }
 
 
 bool QtMotionTracking::step()
 {
-  bool _objectDetected = false;
-  debugMode = false;
-  trackingEnabled = true;
-  pause = false;
-
-  try
+  //we can loop the video by re-opening the capture every time the video reaches its last frame
+  if (!frameSource->isRunning())
   {
-    //we can loop the video by re-opening the capture every time the video reaches its last frame
+    qDebug("opening '%s'", qPrintable(source));
+    pipeline->resetSequence();
+    return frameSource->start();
+  }
+  return true;
+}
 
-    if (!libvlc_media_player_is_playing(vlcMediaMplayer.get()) &&
-        libvlc_media_get_state        (       vlcMedia.get()  ) != libvlc_Opening)
-    {
-      qDebug("opening '%s'", qPrintable(source));
-      opening = true;
-      int play_result = libvlc_media_player_play(vlcMediaMplayer.get());
-      printf("play_result %d\n", play_result);
-      hasLastImage = false;
 
-    }
+void QtMotionTracking::publish(DetectionFrame& frame)
+{
+  benchmarkFilter.add(frame.processingTimeMs);
 
+  if (packetRecorder)
+  {
+    packetRecorder->motion(frame.pts, frame.objectDetected, frame.objectBoundingRectangle);
+  }
 
-    const auto start1 = chrono::steady_clock::now();
+  const auto avg1 = benchmarkFilter.avg();
+  const auto fps1 = 1.0/(avg1/1000.0);
 
+  if (frame.objectDetected)
+  {
+    objectDetectedCount += 1;
 
-    //copy second frame
-    if (!imageQueue.empty())
-    {
-      frames += 1;
-      if (frames % 100 == 0)
-      {
-        printf("frame %d\n", frames);
-      }
-      currentImage = *imageQueue.front();
-      imageQueue.pop();
-
-      //convert currentImage to gray scale for frame differencing
-      cv::resize(currentImage, currentImageSmall, smallSize, 0, 0, INTER_AREA);
-      cv::cvtColor(currentImageSmall, currentGrayImageSmall, COLOR_BGR2GRAY);
-
-      if (hasLastImage)
-      {
-        //perform frame differencing with the sequential images. This will output an "intensity image"
-        //do not confuse this with a threshold image, we will need to perform thresholding afterwards.
-        cv::absdiff(lastGrayImageSmall, currentGrayImageSmall, differenceImage);
-        //threshold intensity image at a given sensitivity value
-        cv::threshold(differenceImage, thresholdImage, SENSITIVITY_VALUE, 255, THRESH_BINARY);
-        if (debugMode == true)
-        {
-          //show the difference image and threshold image
-          cv::imshow("Difference Image", differenceImage);
-          cv::imshow("Threshold Image", thresholdImage);
-        }
-        else
-        {
-          //if not in debug mode, destroy the windows so we don't see them anymore
-          cv::destroyWindow("Difference Image");
-          cv::destroyWindow("Threshold Image");
-        }
-        //blur the image to get rid of the noise. This will output an intensity image
-        cv::blur(thresholdImage, thresholdImage, cv::Size(BLUR_SIZE, BLUR_SIZE));
-        //threshold again to obtain binary image from blur output
-        cv::threshold(thresholdImage, thresholdImage, SENSITIVITY_VALUE, 255, THRESH_BINARY);
-        if (debugMode == true)
-        {
-          //show the threshold image after it's been "blurred"
-
-          imshow("Final Threshold Image", thresholdImage);
-
-        }
-        else
-        {
-          //if not in debug mode, destroy the windows so we don't see them anymore
-          cv::destroyWindow("Final Threshold Image");
-        }
-
-        uint32_t x, y;
-
-        //if tracking enabled, search for contours in our thresholded image
-        if (trackingEnabled)
-        {
-          _objectDetected = searchForMovement(thresholdImage, currentImageSmall, x, y);
-        }
-        else
-        {
-          _objectDetected = false;
-        }
-
-
-        const auto end = chrono::steady_clock::now();
-        const auto diff1 = end - start1;
-        benchmarkFilter.add(chrono::duration <double, milli> (diff1).count());
-
-        const auto avg1 = benchmarkFilter.avg();
-        const auto fps1 = 1.0/(avg1/1000.0);
-
-        if (_objectDetected)
-        {
-          objectDetectedCount += 1;
-
-          printf("frames:%d, odc=%u, BM1: %4.2lfms, %3.2lffps, x=%d y=%d\n",
-                 frames, objectDetectedCount, avg1, fps1, x, y);
-
-          emit objectDetected(x, y);
-        }
-
-        //show our captured frame
-        if (_objectDetected)
-        {
-          //imshow("Input Image", currentImageSmall);
-          oVideoWriter.write(currentImageSmall);
-        }
-
-      }
-      lastGrayImageSmall = currentGrayImageSmall.clone();
-      hasLastImage = true;
-    }
-    else
-    {
-      printf("queue was empty\n");
+    printf("frames:%d, odc=%u, BM1: %4.2lfms, %3.2lffps, id=%u x=%d y=%d vx=%.0lf vy=%.0lf tracks=%u\n",
+           frame.frameNumber, objectDetectedCount, avg1, fps1, frame.objectId, frame.x, frame.y, frame.vx, frame.vy,
+           (unsigned int)frame.tracks.size());
 
-    }
+    emit objectDetected(frame.x, frame.y, frame.vx, frame.vy);
   }
-  catch (const cv::Exception& e)
+
+  for (size_t i = 0; i < frame.tracks.size(); ++i)
   {
-    cout<<"Caught Exception:" << e.what() <<endl;
+    const Track& track = frame.tracks[i];
+    emit objectTracked(track.id, cvRound(track.x), cvRound(track.y), track.vx, track.vy);
   }
+}
 
-  return _objectDetected;
+
+bool QtMotionTracking::wantsRecording(const DetectionFrame&) const
+{
+  //the frame recorder decides itself, it needs the frames before an event as well
+  return frameRecorder.get() != NULL;
+}
+
+
+void QtMotionTracking::record(DetectionFrame& frame)
+{
+  frameRecorder->addFrame(frame.raw, frame.pts, frame.objectDetected, frame.objectBoundingRectangle);
 }
 
 
@@ -350,65 +180,24 @@ void QtMotionTracking::close()
   qDebug("QtMotionTracking::close()");
   motionTrackingThread.quit();
   motionTrackingThread.wait(5000);
-
-  if (oVideoWriter.isOpened())
+  //after the thread stopped, so step() cannot restart it
+  if (frameSource)
   {
-    oVideoWriter.release();
+    frameSource->stop();
   }
-}
-
-
-bool QtMotionTracking::searchForMovement(cv::Mat thresholdImage, cv::Mat &cameraFeed, uint32_t& x, uint32_t& y)
-{
-  //notice how we use the '&' operator for objectDetected and cameraFeed. This is because we wish
-  //to take the values passed into the function and manipulate them, rather than just working with a copy.
-  //eg. we draw to the cameraFeed to be displayed in the main() function.
-  bool objectDetected = false;
-  Mat temp;
-  thresholdImage.copyTo(temp);
-  //these two vectors needed for output of findContours
-  vector< vector<Point> > contours;
-  vector<Vec4i> hierarchy;
-  //find contours of filtered image using openCV findContours function
-  //findContours(temp,contours,hierarchy,CV_RETR_CCOMP,CV_CHAIN_APPROX_SIMPLE );// retrieves all contours
-  findContours(temp, contours, hierarchy, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE );  // retrieves external contours
-
-  //if contours vector is not empty, we have found some objects
-  if (contours.size() > 0)
+  //the record stage and the packet recorder write out what is still
+  //queued, then the files are finished
+  if (pipeline)
   {
-    objectDetected=true;
+    pipeline->stop();
   }
-  else
+  if (packetRecorder)
   {
-    objectDetected = false;
+    packetRecorder->close();
   }
 
-  if (objectDetected)
+  if (frameRecorder)
   {
-    //the largest contour is found at the end of the contours vector
-    //we will simply assume that the biggest contour is the object we are looking for.
-    vector< vector<Point> > largestContourVec;
-    largestContourVec.push_back(contours.at(contours.size()-1));
-    //make a bounding rectangle around the largest contour then find its centroid
-    //this will be the object's final estimated position.
-    objectBoundingRectangle = boundingRect(largestContourVec.at(0));
-    x = objectBoundingRectangle.x+objectBoundingRectangle.width/2;
-    y = objectBoundingRectangle.y+objectBoundingRectangle.height/2;
-
-#if 0
-    //draw some crosshairs around the object
-    circle(cameraFeed, Point(x, y), 20, Scalar(0, 255, 0), 2);
-    line(cameraFeed, Point(x, y), Point(x, y-25), Scalar(0, 255, 0), 2);
-    line(cameraFeed, Point(x, y), Point(x, y+25), Scalar(0, 255, 0), 2);
-    line(cameraFeed, Point(x, y), Point(x-25, y), Scalar(0, 255, 0), 2);
-    line(cameraFeed, Point(x, y), Point(x+25, y), Scalar(0, 255, 0), 2);
-#else
-    rectangle(cameraFeed, objectBoundingRectangle, Scalar(255, 255, 0));
-
-#endif
-
-
+    frameRecorder->close();
   }
-
-  return objectDetected;
 }
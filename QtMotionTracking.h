@@ -29,6 +29,12 @@
 #include <opencv/highgui.h>
 #include <chrono>
 #include "SMA.h"
+#include "FrameRing.h"
+#include "MotionSettings.h"
+#include "FrameSource.h"
+#include "DetectionPipeline.h"
+#include "FrameRecorder.h"
+#include "PacketRecorder.h"
 #include <cstdint>
 #include <ctime>
 #include <memory>
@@ -36,8 +42,7 @@
 #include <QDebug>
 #include <QThread>
 #include <QTimer>
-#include <vlc/vlc.h>
-#include <queue>
+#include <cstdio>
 
 class QtMotionTracking : public QObject
 {
@@ -47,87 +52,56 @@ public:
   QtMotionTracking();
   virtual ~QtMotionTracking();
 
-  bool open(const QString& source_, const QString& dest);
+  bool open(const QString& source_, const QString& dest, const MotionSettings& settings_);
   QTimer reopenTimer;
 
   void close();
 
-  bool searchForMovement(cv::Mat thresholdImage, cv::Mat &cameraFeed, uint32_t& x, uint32_t& y);
-
-  std::shared_ptr<libvlc_instance_t> vlcInstance;
-  std::shared_ptr<libvlc_media_t> vlcMedia;
-  std::shared_ptr<libvlc_media_player_t> vlcMediaMplayer;
+  //producer of the frames, see FrameSource::create()
+  std::shared_ptr<FrameSource> frameSource;
 
 
   QThread motionTrackingThread;
 
-//our sensitivity value to be used in the absdiff() function
-  static const int SENSITIVITY_VALUE = 40;
-//size of blur used to smooth the intensity image output from absdiff() function
-  const static int BLUR_SIZE = 10;
-
-//bounding rectangle of the object, we will use the center of this as its position.
-  cv::Rect objectBoundingRectangle;
-
   uint32_t objectDetectedCount;
   cv::Size smallSize;
   QString source;
+  MotionSettings settings;
 
-  //these two can be toggled by pressing 'd' or 't'
-  bool debugMode;
-  bool trackingEnabled;
-  //pause and resume code
-  bool pause;
-  //set up the matrices that we will need
-  //the two frames we will be comparing
-
-  bool hasLastImage;
-
-  std::shared_ptr<cv::Mat> nextImage;
-  std::queue<std::shared_ptr<cv::Mat> > imageQueue;
+  //number of decoded frames that may wait for the pipeline before frames get dropped
+  static const unsigned int FRAME_RING_CAPACITY = 4;
+  //frames handed over from the capture thread to the pipeline
+  std::shared_ptr<FrameRing> frameRing;
+  //the detection stages, see DetectionPipeline
+  std::shared_ptr<DetectionPipeline> pipeline;
 
-  cv::Mat lastImage;
-  cv::Mat currentImage;
-  //their grayscale images (needed for absdiff() function)
-
-  cv::Mat currentGrayImageSmall;
-  cv::Mat lastGrayImageSmall;
-  cv::Mat lastImageSmall;
-  cv::Mat currentImageSmall;
-
-
-  //resulting difference image
-  cv::Mat differenceImage;
-  //thresholded difference image (for use in findContours() function)
-  cv::Mat thresholdImage;
-  //video capture object.
-  cv::VideoCapture capture;
-  cv::VideoWriter oVideoWriter;
+  //exactly one of the two records the events, see MotionSettings::RecordMode
+  std::shared_ptr<FrameRecorder> frameRecorder;
+  std::shared_ptr<PacketRecorder> packetRecorder;
 
+  //used by the publish stage only
   SMA benchmarkFilter;
-  uint32_t frames;
 
   double xEye;
   double yEye;
 
 
 public slots:
+  //restarts the capture when it stopped
   bool step();
 
 signals:
   void triggerStep();
-  void objectDetected(int x, int y);
+  //position of the object in pixels, where it is heading in pixels per second
+  void objectDetected(int x, int y, double vx, double vy);
+  //every confirmed track of a frame, position in pixels, velocity in pixels per second
+  void objectTracked(int id, int x, int y, double vx, double vy);
 
 private:
-  bool opening = false;
-  void handleEventMember(const libvlc_event_t* pEvt);
-
-  static void cbVideoPrerender(void* p_video_data, uint8_t** pp_pixel_buffer, int size);
-  static void cbVideoPostrender(void* p_video_data, uint8_t* p_pixel_buffer, int width, int height, int pixel_pitch,
-                                int size, int64_t pts);
-
-  void videoPrerender(uint8_t** pp_pixel_buffer, int size);
-  void videoPostRender(uint8_t* p_pixel_buffer, int width, int height, int pixel_pitch, int size, int64_t pts);
+  //called on the pipeline's publish and record threads
+  void publish(DetectionFrame& frame);
+  bool wantsRecording(const DetectionFrame& frame) const;
+  void record(DetectionFrame& frame);
 };
 
 
@@ -0,0 +1,70 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RawFileCapture.h"
+
+#include <cstdio>
+
+RawFileCapture::RawFileCapture(const std::string& fileName, const cv::Size& size, const MotionSettings& settings,
+                               const std::shared_ptr<FrameRing>& ring, const FrameCallback& frameCallback)
+  : ThreadedFrameSource(fileName, size, settings, ring, frameCallback)
+{ }
+
+
+RawFileCapture::~RawFileCapture()
+{
+  stop();
+}
+
+
+void RawFileCapture::run()
+{
+  FILE* file = fopen(url.c_str(), "rb");
+  if (!file)
+  {
+    printf("raw: could not open '%s'\n", url.c_str());
+    return;
+  }
+
+  const size_t bytes = frameBytes(size, settings.captureFormat);
+  const int64_t frameDurationUs = (int64_t)(1000000.0 / settings.frameRate);
+  int64_t pts = 0;
+
+  for (;;)
+  {
+    if (!pace(pts))
+    {
+      break;
+    }
+
+    uint8_t* buffer = frameRing->beginWrite(bytes);
+    if (fread(buffer, 1, bytes, file) != bytes)
+    {
+      printf("raw: end of '%s'\n", url.c_str());
+      break;
+    }
+
+    deliver(size, pts);
+    pts += frameDurationUs;
+  }
+
+  fclose(file);
+}
@@ -0,0 +1,49 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RAW_FILE_CAPTURE_H_INCLUDED
+#define RAW_FILE_CAPTURE_H_INCLUDED
+
+#include "FrameSource.h"
+
+/**
+   Frame source replaying a raw frame dump as written by qtmotion --dump-frames.
+
+   The file holds consecutive frames without any header, in the capture
+   format and at the detection size of the settings, so those have to match
+   the run that produced the dump. Frames are timestamped with
+   MotionSettings::frameRate.
+ */
+class RawFileCapture : public ThreadedFrameSource
+{
+public:
+
+  RawFileCapture(const std::string& fileName, const cv::Size& size, const MotionSettings& settings,
+                 const std::shared_ptr<FrameRing>& ring, const FrameCallback& frameCallback);
+  virtual ~RawFileCapture();
+
+protected:
+
+  virtual void run();
+};
+
+
+#endif
@@ -0,0 +1,167 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RegionOfInterest.h"
+
+#include <opencv/highgui.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "CoarseMotion.h"
+
+RegionOfInterest::RegionOfInterest(const cv::Size& detectionSize_, int blurSize_)
+  : detectionSize(detectionSize_),
+  blurSize(blurSize_),
+  tilesX((detectionSize_.width + CoarseMotion::TILE_SIZE - 1) / CoarseMotion::TILE_SIZE),
+  tilesY((detectionSize_.height + CoarseMotion::TILE_SIZE - 1) / CoarseMotion::TILE_SIZE),
+  loaded(false),
+  tileStates(tilesX * tilesY, TileIncluded)
+{ }
+
+
+bool RegionOfInterest::load(const std::string& fileName)
+{
+  // an image is anything imread understands, otherwise polygons
+  const cv::Mat image = cv::imread(fileName, 0);
+  if (!image.empty())
+  {
+    cv::resize(image, mask, detectionSize, 0, 0, cv::INTER_NEAREST);
+    cv::threshold(mask, mask, 0, 255, cv::THRESH_BINARY);
+  }
+  else if (!loadPolygons(fileName))
+  {
+    return false;
+  }
+
+  // the box of an included pixel must not reach any excluded one, it is
+  // anchored and reflected at the border like cv::blur's
+  cv::erode(mask, mask, cv::Mat::ones(blurSize, blurSize, CV_8UC1), cv::Point(-1, -1), 1,
+            cv::BORDER_REFLECT_101);
+
+  loaded = true;
+  updateTiles();
+  return true;
+}
+
+
+bool RegionOfInterest::loadPolygons(const std::string& fileName)
+{
+  std::ifstream file(fileName.c_str());
+  if (!file)
+  {
+    return false;
+  }
+
+  std::vector< std::vector<cv::Point> > includes;
+  std::vector< std::vector<cv::Point> > excludes;
+  std::string line;
+  while (std::getline(file, line))
+  {
+    std::istringstream words(line);
+    std::string kind;
+    if (!(words >> kind) || kind[0] == '#')
+    {
+      continue;
+    }
+    if (kind != "include" && kind != "exclude")
+    {
+      printf("%s: unknown line \"%s\"\n", fileName.c_str(), line.c_str());
+      return false;
+    }
+
+    std::vector<cv::Point> polygon;
+    std::string point;
+    while (words >> point)
+    {
+      int x;
+      int y;
+      if (sscanf(point.c_str(), "%d,%d", &x, &y) != 2)
+      {
+        printf("%s: bad point \"%s\"\n", fileName.c_str(), point.c_str());
+        return false;
+      }
+      polygon.push_back(cv::Point(x, y));
+    }
+
+    if (polygon.size() < 3)
+    {
+      printf("%s: a polygon needs three points \"%s\"\n", fileName.c_str(), line.c_str());
+      return false;
+    }
+    (kind == "include" ? includes : excludes).push_back(polygon);
+  }
+
+  mask = cv::Mat::zeros(detectionSize, CV_8UC1);
+  if (includes.empty())
+  {
+    mask.setTo(cv::Scalar(255));
+  }
+  else
+  {
+    cv::fillPoly(mask, includes, cv::Scalar(255));
+  }
+  if (!excludes.empty())
+  {
+    cv::fillPoly(mask, excludes, cv::Scalar(0));
+  }
+  return true;
+}
+
+
+void RegionOfInterest::updateTiles()
+{
+  const int tile = CoarseMotion::TILE_SIZE;
+  for (int ty = 0; ty < tilesY; ++ty)
+  {
+    for (int tx = 0; tx < tilesX; ++tx)
+    {
+      const cv::Rect rect = cv::Rect(tx * tile, ty * tile, tile, tile) &
+                            cv::Rect(0, 0, detectionSize.width, detectionSize.height);
+      const int included = cv::countNonZero(mask(rect));
+      tileStates[ty * tilesX + tx] = included == 0 ? TileExcluded :
+                                     included == rect.area() ? TileIncluded : TilePartial;
+    }
+  }
+}
+
+
+void RegionOfInterest::apply(cv::Mat& image, const std::vector<cv::Rect>& regions) const
+{
+  const int tile = CoarseMotion::TILE_SIZE;
+  for (size_t i = 0; i < regions.size(); ++i)
+  {
+    // completely included tiles need no masking
+    const cv::Rect& region = regions[i];
+    const int ty = region.y / tile;
+    for (int tx = region.x / tile; tx * tile < region.x + region.width; ++tx)
+    {
+      if (tileStates[ty * tilesX + tx] == TileIncluded)
+      {
+        continue;
+      }
+
+      const cv::Rect rect = cv::Rect(tx * tile, ty * tile, tile, tile) & region;
+      cv::Mat target = image(rect);
+      cv::bitwise_and(target, mask(rect), target);
+    }
+  }
+}
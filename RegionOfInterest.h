@@ -0,0 +1,102 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef REGION_OF_INTEREST_H_INCLUDED
+#define REGION_OF_INTEREST_H_INCLUDED
+
+#include <opencv/cv.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+   The part of the camera picture motion is searched in, to keep roads,
+   swaying trees and porch lights out of the detection.
+
+   Loaded from a file, either an image of any size, where black is excluded
+   and everything else included, or a text file of polygons in pixels of
+   the detection image, one per line:
+
+   include 20,240 20,100 300,100 300,240
+   exclude 120,100 160,100 160,140
+
+   Without include lines everything is included. Lines starting with # are
+   comments.
+
+   The mask is applied to the finished motion mask, after the blur. So that
+   motion in an excluded area cannot spread through the blur into included
+   pixels next to it, the excluded area is grown by the blur box when the
+   file is loaded: a pixel only stays included if its whole box is.
+
+   The mask is split into the tiles of CoarseMotion. Tiles without any
+   included pixel are never computed, tiles that are included completely
+   need no masking afterwards, only the tiles on a border are masked.
+ */
+class RegionOfInterest
+{
+public:
+
+  /** blurSize is the box the motion mask is blurred with, see MotionDetector::BLUR_SIZE. */
+  RegionOfInterest(const cv::Size& detectionSize, int blurSize);
+
+  /** Loads the mask, false if the file cannot be read. */
+  bool load(const std::string& fileName);
+
+  /** False until a mask was loaded. */
+  bool active() const
+  {
+    return loaded;
+  }
+
+  /** TileState per tile, row by row. */
+  const std::vector<uint8_t>& tiles() const
+  {
+    return tileStates;
+  }
+
+  /** Clears the excluded pixels of mask inside regions, each region a run of tiles in one row. */
+  void apply(cv::Mat& mask, const std::vector<cv::Rect>& regions) const;
+
+  enum TileState
+  {
+    TileExcluded,
+    TilePartial,
+    TileIncluded
+  };
+
+private:
+
+  bool loadPolygons(const std::string& fileName);
+  void updateTiles();
+
+  const cv::Size detectionSize;
+  const int blurSize;
+  const int tilesX;
+  const int tilesY;
+  bool loaded;
+
+  //CV_8UC1 of the detection size, 255 where motion counts
+  cv::Mat mask;
+  std::vector<uint8_t> tileStates;
+};
+
+
+#endif
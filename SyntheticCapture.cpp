@@ -0,0 +1,109 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "SyntheticCapture.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+SyntheticCapture::SyntheticCapture(const std::string& url, const cv::Size& size, const MotionSettings& settings,
+                                   const std::shared_ptr<FrameRing>& ring, const FrameCallback& frameCallback)
+  : ThreadedFrameSource(url, size, settings, ring, frameCallback),
+  noiseState(0x12345678u)
+{ }
+
+
+SyntheticCapture::~SyntheticCapture()
+{
+  stop();
+}
+
+
+void SyntheticCapture::run()
+{
+  const uint32_t frameLimit = (uint32_t)strtoul(url.c_str() + strlen("synthetic:"), NULL, 10);
+  const size_t bytes = frameBytes(size, settings.captureFormat);
+  const int64_t frameDurationUs = (int64_t)(1000000.0 / settings.frameRate);
+
+  // same sequence on every start, runs are comparable
+  noiseState = 0x12345678u;
+
+  for (uint32_t frameNumber = 0; frameLimit == 0 || frameNumber < frameLimit; ++frameNumber)
+  {
+    const int64_t pts = frameNumber * frameDurationUs;
+    if (!pace(pts))
+    {
+      return;
+    }
+
+    render(frameRing->beginWrite(bytes), frameNumber);
+    deliver(size, pts);
+  }
+  printf("synthetic: generated %u frames\n", frameLimit);
+}
+
+
+void SyntheticCapture::render(uint8_t* buffer, uint32_t frameNumber)
+{
+  // the walker is a quarter of the picture high and crosses it in 100 frames
+  const int walkerWidth = size.width / 16;
+  const int walkerHeight = size.height / 4;
+  const int travel = size.width - walkerWidth;
+  const int phase = frameNumber % 200;
+  const int walkerX = (phase < 100 ? phase : 200 - phase) * travel / 100;
+  const int walkerY = size.height / 2;
+
+  const bool luma = settings.captureFormat == MotionSettings::CaptureLuma;
+  const int channels = luma ? 1 : 3;
+
+  for (int y = 0; y < size.height; ++y)
+  {
+    uint8_t* row = buffer + (size_t)y * size.width * channels;
+    const bool walkerRow = y >= walkerY && y < walkerY + walkerHeight;
+
+    for (int x = 0; x < size.width; ++x)
+    {
+      // xorshift32, noise of +-4 stays well below SENSITIVITY_VALUE
+      noiseState ^= noiseState << 13;
+      noiseState ^= noiseState >> 17;
+      noiseState ^= noiseState << 5;
+      int value = 40 + (x + y) * 100 / (size.width + size.height) + (int)(noiseState & 7) - 4;
+
+      if (walkerRow && x >= walkerX && x < walkerX + walkerWidth)
+      {
+        value = 220;
+      }
+
+      for (int c = 0; c < channels; ++c)
+      {
+        row[x * channels + c] = (uint8_t)value;
+      }
+    }
+  }
+
+  if (luma)
+  {
+    // neutral chroma
+    const size_t lumaBytes = (size_t)size.width * size.height;
+    memset(buffer + lumaBytes, 128, lumaBytes / 2);
+  }
+}
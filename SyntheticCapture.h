@@ -0,0 +1,54 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SYNTHETIC_CAPTURE_H_INCLUDED
+#define SYNTHETIC_CAPTURE_H_INCLUDED
+
+#include "FrameSource.h"
+
+/**
+   Frame source generating test pictures, no camera or network needed.
+
+   Every frame is a gray gradient with a little deterministic sensor noise and
+   a bright "walker" crossing the picture back and forth. The url
+   "synthetic:<n>" limits the run to n frames, "synthetic:" runs forever.
+ */
+class SyntheticCapture : public ThreadedFrameSource
+{
+public:
+
+  SyntheticCapture(const std::string& url, const cv::Size& size, const MotionSettings& settings,
+                   const std::shared_ptr<FrameRing>& ring, const FrameCallback& frameCallback);
+  virtual ~SyntheticCapture();
+
+protected:
+
+  virtual void run();
+
+private:
+
+  void render(uint8_t* buffer, uint32_t frameNumber);
+
+  uint32_t noiseState;
+};
+
+
+#endif
@@ -0,0 +1,205 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ * Based on https://github.com/jrterven/OpenCV-VLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "VlcCapture.h"
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <cstdio>
+
+VlcCapture::VlcCapture(const std::string& url, const cv::Size& size, const MotionSettings& settings,
+                       const std::shared_ptr<FrameRing>& ring, const FrameCallback& frameCallback)
+  : FrameSource(url, size, settings, ring, frameCallback)
+{ }
+
+
+VlcCapture::~VlcCapture()
+{
+  stop();
+}
+
+
+void VlcCapture::cbVideoPrerender(void* p_video_data, uint8_t** pp_pixel_buffer, int size)
+{
+  ((VlcCapture*)p_video_data)->videoPrerender(pp_pixel_buffer, size);
+}
+
+
+void VlcCapture::videoPrerender(uint8_t** pp_pixel_buffer, int size)
+{
+  *pp_pixel_buffer = frameRing->beginWrite(size);
+}
+
+
+void VlcCapture::cbVideoPostrender(void* p_video_data, uint8_t* p_pixel_buffer, int width, int height,
+                                   int pixel_pitch, int size, int64_t pts)
+{
+  ((VlcCapture*)p_video_data)->videoPostRender(p_pixel_buffer, width, height, pixel_pitch, size, pts);
+}
+
+
+void VlcCapture::videoPostRender(uint8_t* p_pixel_buffer, int width, int height, int pixel_pitch, int size,
+                                 int64_t pts)
+{
+  deliver(cv::Size(width, height), pts);
+}
+
+
+void VlcCapture::handleEventMember(const libvlc_event_t* pEvt)
+{
+  libvlc_time_t time;
+  switch (pEvt->type)
+  {
+    case libvlc_MediaPlayerTimeChanged:
+      time = libvlc_media_player_get_time(vlcMediaMplayer.get());
+      //printf("MediaPlayerTimeChanged %lld ms\n", (long long)time);
+      break;
+
+    case libvlc_MediaPlayerPlaying:
+      printf("%s\n", libvlc_event_type_name(pEvt->type));
+      break;
+
+    case libvlc_MediaPlayerStopped:
+    case libvlc_MediaPlayerEndReached:
+
+      printf("%s\n", libvlc_event_type_name(pEvt->type));
+      //let the consumer notice early that the player has to be restarted
+      notifyEnd();
+      break;
+
+    case libvlc_MediaPlayerPositionChanged:
+      break;
+
+    case libvlc_MediaStateChanged:
+      printf("%s\n", libvlc_event_type_name(pEvt->type));
+      printf("state %d\n", libvlc_media_get_state       (       vlcMedia.get()  )       );
+      notifyEnd();
+      break;
+
+    default:
+      printf("%s\n", libvlc_event_type_name(pEvt->type));
+  }
+}
+
+
+bool VlcCapture::create()
+{
+  // VLC options
+  char smem_options[1000];
+
+  // the decoder scales to the detection size, so the consumer does not have to resize
+  sprintf(smem_options,
+          "#transcode{vcodec=%s,width=%d,height=%d}:smem{"
+          "video-prerender-callback=%" PRId64 ","
+          "video-postrender-callback=%" PRId64 ","
+          "video-data=%" PRId64 ","
+          "no-time-sync},",
+          settings.captureFormat == MotionSettings::CaptureLuma ? "I420" : "RV24",
+          size.width, size.height,
+          (long long int)(intptr_t)(void*)&cbVideoPrerender,
+          (long long int)(intptr_t)(void*)&cbVideoPostrender,
+          (long long int)(intptr_t)(void*)this
+         );
+
+  const char* const vlc_args[] = {
+    "-I", "dummy",                        // Don't use any interface
+    "--ignore-config",                    // Don't use VLC's config
+    "--no-xlib",
+    "--no-audio",
+    "--aout=none",
+    "--extraintf=logger",                 // Log anything
+//    "--verbose=2",                        // Be verbose
+    "--sout", smem_options                // Stream to memory
+  };
+
+  // Launch VLC
+  vlcInstance =
+    std::shared_ptr<libvlc_instance_t>(libvlc_new(sizeof(vlc_args) / sizeof(vlc_args[0]), vlc_args),
+                                       [=](libvlc_instance_t* ptr)
+  {
+    libvlc_release(ptr);
+  });
+
+  vlcMedia =
+    std::shared_ptr<libvlc_media_t>(libvlc_media_new_location(vlcInstance.get(), url.c_str()),
+                                    [=](libvlc_media_t* ptr)
+  {
+    libvlc_media_release(ptr);
+  });
+
+  vlcMediaMplayer =
+    std::shared_ptr<libvlc_media_player_t>(libvlc_media_player_new_from_media(vlcMedia.get()),
+                                           [=](libvlc_media_player_t* ptr)
+  {
+    libvlc_media_player_release(ptr);
+  });
+
+  libvlc_event_manager_t* eventManager = libvlc_media_player_event_manager(vlcMediaMplayer.get());
+
+  auto handleEvent([](const libvlc_event_t* pEvt, void* pUserData)
+    {
+                   ((VlcCapture*)pUserData)->handleEventMember(pEvt);
+    });
+  libvlc_event_attach(eventManager, libvlc_MediaPlayerTimeChanged, handleEvent, this);
+  libvlc_event_attach(eventManager, libvlc_MediaPlayerEndReached, handleEvent, this);
+  libvlc_event_attach(eventManager, libvlc_MediaPlayerStopped, handleEvent, this);
+  libvlc_event_attach(eventManager, libvlc_MediaPlayerPlaying, handleEvent, this);
+  libvlc_event_attach(eventManager, libvlc_MediaPlayerPositionChanged, handleEvent, this);
+
+  libvlc_event_manager_t* eventManager2 = libvlc_media_event_manager(vlcMedia.get());
+  libvlc_event_attach(eventManager2, libvlc_MediaStateChanged, handleEvent, this);
+  return true;
+}
+
+
+bool VlcCapture::start()
+{
+  if (!vlcMediaMplayer && !create())
+  {
+    return false;
+  }
+
+  int play_result = libvlc_media_player_play(vlcMediaMplayer.get());
+  printf("play_result %d\n", play_result);
+  return play_result == 0;
+}
+
+
+void VlcCapture::stop()
+{
+  if (vlcMediaMplayer)
+  {
+    libvlc_media_player_stop(vlcMediaMplayer.get());
+  }
+}
+
+
+bool VlcCapture::isRunning() const
+{
+  if (!vlcMediaMplayer)
+  {
+    return false;
+  }
+
+  return libvlc_media_player_is_playing(vlcMediaMplayer.get()) ||
+         libvlc_media_get_state        (       vlcMedia.get()  ) == libvlc_Opening;
+}
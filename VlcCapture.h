@@ -0,0 +1,67 @@
+/* Copyright (c) 2016 Bastian Schmitz
+ * Based on https://github.com/jrterven/OpenCV-VLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef VLC_CAPTURE_H_INCLUDED
+#define VLC_CAPTURE_H_INCLUDED
+
+#include <memory>
+#include <vlc/vlc.h>
+
+#include "FrameSource.h"
+
+/**
+   Frame source using libvlc. VLC transcodes to the capture format at the
+   detection size and its smem output module hands every picture to the
+   FrameRing from VLC's streaming thread.
+ */
+class VlcCapture : public FrameSource
+{
+public:
+
+  VlcCapture(const std::string& url, const cv::Size& size, const MotionSettings& settings,
+             const std::shared_ptr<FrameRing>& ring, const FrameCallback& frameCallback);
+  virtual ~VlcCapture();
+
+  virtual bool start();
+  virtual void stop();
+  virtual bool isRunning() const;
+
+private:
+
+  bool create();
+
+  std::shared_ptr<libvlc_instance_t> vlcInstance;
+  std::shared_ptr<libvlc_media_t> vlcMedia;
+  std::shared_ptr<libvlc_media_player_t> vlcMediaMplayer;
+
+  void handleEventMember(const libvlc_event_t* pEvt);
+
+  static void cbVideoPrerender(void* p_video_data, uint8_t** pp_pixel_buffer, int size);
+  static void cbVideoPostrender(void* p_video_data, uint8_t* p_pixel_buffer, int width, int height, int pixel_pitch,
+                                int size, int64_t pts);
+
+  void videoPrerender(uint8_t** pp_pixel_buffer, int size);
+  void videoPostRender(uint8_t* p_pixel_buffer, int width, int height, int pixel_pitch, int size, int64_t pts);
+};
+
+
+#endif
@@ -25,6 +25,7 @@
 #include <QRegExp>
 
 #include "CtrlCHandler.h"
+#include "KernelBenchmark.h"
 #include "QtMotion.h"
 
 extern "C"
@@ -41,6 +42,11 @@ int main(int argc, char** argv)
   QCoreApplication app(argc, argv);
   const QStringList args = app.arguments();
 
+  if (args.contains("--benchmark-kernel"))
+  {
+    return runKernelBenchmark();
+  }
+
   QObject::connect(CtrlCHandler::instance(), SIGNAL(activated()), &app, SLOT(quit()));
   CtrlCHandler::instance()->install();
 
@@ -50,8 +56,36 @@ int main(int argc, char** argv)
   const QRegExp rxArgsRotated("--rotated");
   bool rotated = false;
 
+  MotionSettings settings;
+  const QRegExp rxArgsCapture("--capture=(luma|rgb)");
+  const QRegExp rxArgsEngine("--engine=(vlc|libav)");
+  const QRegExp rxArgsProbeSize("--probesize=(\\d+)");
+  const QRegExp rxArgsAnalyzeDuration("--analyzeduration=(\\d+)");
+  const QRegExp rxArgsPace("--pace=(realtime|fast)");
+  const QRegExp rxArgsFrameRate("--fps=([\\d.]+)");
+  const QRegExp rxArgsDumpFrames("--dump-frames=(.+)");
+  const QRegExp rxArgsBacklog("--backlog=(all|latest)");
+  const QRegExp rxArgsMaxAge("--max-age=(\\d+)");
+  const QRegExp rxArgsRecord("--record=(reencode|remux)");
+  const QRegExp rxArgsPreTrigger("--pre-trigger=(\\d+)");
+  const QRegExp rxArgsPostTrigger("--post-trigger=(\\d+)");
+  const QRegExp rxArgsPreRollMemory("--pre-roll-memory=(\\d+)");
+  const QRegExp rxArgsTargets("--targets=(single|multiple)");
+  const QRegExp rxArgsMinArea("--min-area=(\\d+)");
+  const QRegExp rxArgsDetection("--detection=(difference|background)");
+  const QRegExp rxArgsLearningRate("--learning-rate=([\\d.]+)");
+  const QRegExp rxArgsCoarse("--coarse=(on|off)");
+  const QRegExp rxArgsThreads("--threads=(\\d+)");
+  const QRegExp rxArgsRoi("--roi=(.+)");
+  const QRegExp rxArgsHeatmap("--heatmap=(.+)");
+  const QRegExp rxArgsAutoRoi("--auto-roi");
+  const QRegExp rxArgsBudget("--budget=(\\d+)");
+  const QRegExp rxArgsCpuBudget("--cpu-budget=(\\d+)");
+  const QRegExp rxArgsClassify("--classify-people");
+
 
-  for (int i = 1; i < args.size(); ++i)
+  // the first two arguments are the source url and the output file
+  for (int i = 3; i < args.size(); ++i)
   {
     if (rxArgsMirrored.indexIn(args.at(i)) != -1 )
     {
@@ -61,13 +95,117 @@ int main(int argc, char** argv)
     {
       rotated = true;
     }
+    else if (rxArgsCapture.indexIn(args.at(i)) != -1 )
+    {
+      settings.captureFormat = rxArgsCapture.cap(1) == "rgb" ? MotionSettings::CaptureColor : MotionSettings::CaptureLuma;
+    }
+    else if (rxArgsEngine.indexIn(args.at(i)) != -1 )
+    {
+      settings.captureEngine = rxArgsEngine.cap(1) == "libav" ? MotionSettings::EngineLibav : MotionSettings::EngineVlc;
+    }
+    else if (rxArgsProbeSize.indexIn(args.at(i)) != -1 )
+    {
+      settings.probeSize = rxArgsProbeSize.cap(1).toLongLong();
+    }
+    else if (rxArgsAnalyzeDuration.indexIn(args.at(i)) != -1 )
+    {
+      settings.analyzeDurationUs = rxArgsAnalyzeDuration.cap(1).toLongLong();
+    }
+    else if (rxArgsPace.indexIn(args.at(i)) != -1 )
+    {
+      settings.pacing = rxArgsPace.cap(1) == "fast" ? MotionSettings::PaceFast : MotionSettings::PaceRealtime;
+    }
+    else if (rxArgsFrameRate.indexIn(args.at(i)) != -1 )
+    {
+      settings.frameRate = rxArgsFrameRate.cap(1).toDouble();
+    }
+    else if (rxArgsDumpFrames.indexIn(args.at(i)) != -1 )
+    {
+      settings.dumpFile = rxArgsDumpFrames.cap(1).toStdString();
+    }
+    else if (rxArgsBacklog.indexIn(args.at(i)) != -1 )
+    {
+      settings.backlogPolicy = rxArgsBacklog.cap(1) == "all" ? MotionSettings::BacklogProcessAll :
+                               MotionSettings::BacklogLatest;
+    }
+    else if (rxArgsMaxAge.indexIn(args.at(i)) != -1 )
+    {
+      settings.maxFrameAgeMs = rxArgsMaxAge.cap(1).toInt();
+    }
+    else if (rxArgsRecord.indexIn(args.at(i)) != -1 )
+    {
+      settings.recordMode = rxArgsRecord.cap(1) == "remux" ? MotionSettings::RecordRemux :
+                            MotionSettings::RecordReencode;
+    }
+    else if (rxArgsPreTrigger.indexIn(args.at(i)) != -1 )
+    {
+      settings.preTriggerMs = rxArgsPreTrigger.cap(1).toInt();
+    }
+    else if (rxArgsPostTrigger.indexIn(args.at(i)) != -1 )
+    {
+      settings.postTriggerMs = rxArgsPostTrigger.cap(1).toInt();
+    }
+    else if (rxArgsPreRollMemory.indexIn(args.at(i)) != -1 )
+    {
+      settings.preRollMemoryMb = rxArgsPreRollMemory.cap(1).toInt();
+    }
+    else if (rxArgsTargets.indexIn(args.at(i)) != -1 )
+    {
+      settings.targetMode = rxArgsTargets.cap(1) == "multiple" ? MotionSettings::TargetMultiple :
+                            MotionSettings::TargetSingle;
+    }
+    else if (rxArgsMinArea.indexIn(args.at(i)) != -1 )
+    {
+      settings.minBlobArea = rxArgsMinArea.cap(1).toUInt();
+    }
+    else if (rxArgsDetection.indexIn(args.at(i)) != -1 )
+    {
+      settings.detectionMode = rxArgsDetection.cap(1) == "background" ? MotionSettings::DetectBackground :
+                               MotionSettings::DetectDifference;
+    }
+    else if (rxArgsLearningRate.indexIn(args.at(i)) != -1 )
+    {
+      settings.learningRate = rxArgsLearningRate.cap(1).toDouble();
+    }
+    else if (rxArgsCoarse.indexIn(args.at(i)) != -1 )
+    {
+      settings.coarseCheck = rxArgsCoarse.cap(1) == "on";
+    }
+    else if (rxArgsThreads.indexIn(args.at(i)) != -1 )
+    {
+      settings.detectionThreads = rxArgsThreads.cap(1).toUInt();
+    }
+    else if (rxArgsRoi.indexIn(args.at(i)) != -1 )
+    {
+      settings.roiFile = rxArgsRoi.cap(1).toStdString();
+    }
+    else if (rxArgsHeatmap.indexIn(args.at(i)) != -1 )
+    {
+      settings.heatmapFile = rxArgsHeatmap.cap(1).toStdString();
+    }
+    else if (rxArgsAutoRoi.indexIn(args.at(i)) != -1 )
+    {
+      settings.autoRoi = true;
+    }
+    else if (rxArgsBudget.indexIn(args.at(i)) != -1 )
+    {
+      settings.frameBudgetMs = rxArgsBudget.cap(1).toInt();
+    }
+    else if (rxArgsCpuBudget.indexIn(args.at(i)) != -1 )
+    {
+      settings.cpuBudgetPercent = rxArgsCpuBudget.cap(1).toInt();
+    }
+    else if (rxArgsClassify.indexIn(args.at(i)) != -1 )
+    {
+      settings.classifyPeople = true;
+    }
     else
     {
       qDebug() << "Unknown command line argument:" << args.at(i);
     }
   }
 
-  QtMotion qtm(args.at(1), args.at(2));
+  QtMotion qtm(args.at(1), args.at(2), settings);
 
 
   const int exitCode = app.exec();